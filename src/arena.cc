@@ -0,0 +1,57 @@
+#include "diy/coro/arena.h"
+
+#include <algorithm>
+#include <cassert>
+
+Arena::~Arena() {
+  assert(live() == 0);
+  // Unlink iteratively, rather than recursively through the destructors.
+  while (chunks_ != nullptr) {
+    chunks_ = std::move(chunks_->next);
+  }
+}
+
+void* Arena::AllocateSlow(std::size_t size, Chunk* full) {
+  auto lock = std::lock_guard(mutex_);
+  Chunk* current = current_chunk_.load(std::memory_order::relaxed);
+  if (current != full) {
+    // Another thread moved on to a new chunk while we were trying `full`.
+    const std::size_t offset =
+        current->used.fetch_add(size, std::memory_order::relaxed);
+    if (offset + size <= current->size) {
+      return current->data.get() + offset;
+    }
+  }
+  std::unique_ptr<Chunk>& next = current == nullptr ? chunks_ : current->next;
+  if (next == nullptr || next->size < size) {
+    // Out of chunks. Oversized allocations get a chunk to themselves.
+    auto chunk = std::make_unique<Chunk>();
+    chunk->size = std::max(size, chunk_size_);
+    chunk->data = std::make_unique_for_overwrite<std::byte[]>(chunk->size);
+    chunk->next = std::move(next);
+    next = std::move(chunk);
+  }
+  next->used.store(size, std::memory_order::relaxed);
+  current_chunk_.store(next.get(), std::memory_order::release);
+  return next->data.get();
+}
+
+void Arena::Reset() {
+  // No lock needed; the chunk list itself is unchanged, and nothing else may
+  // be allocating.
+  for (Chunk* chunk = chunks_.get(); chunk != nullptr;
+       chunk = chunk->next.get()) {
+    chunk->used.store(0, std::memory_order::relaxed);
+  }
+  current_chunk_.store(chunks_.get(), std::memory_order::release);
+}
+
+std::size_t Arena::reserved_bytes() const {
+  auto lock = std::lock_guard(mutex_);
+  std::size_t total = 0;
+  for (Chunk* chunk = chunks_.get(); chunk != nullptr;
+       chunk = chunk->next.get()) {
+    total += chunk->size;
+  }
+  return total;
+}
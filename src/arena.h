@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "diy/coro/traits.h"
+
+// Bump allocator for coroutine frames that are created and destroyed together,
+// such as those of a single request. Memory is carved out of chunks, freeing
+// an individual allocation only decrements a count, and once every allocation
+// has been freed the arena starts over from the beginning of its first chunk.
+// Chunks are kept for reuse until the arena is destroyed.
+//
+// Coroutine frames are only allocated from arenas when building with
+// DIY_CORO_ARENAS defined (see the DIY_ENABLE_ARENAS CMake option); otherwise
+// ArenaScope has no effect, and promise types are unchanged in size and cost.
+//
+// Because memory is only reclaimed once the arena is empty, an arena should
+// not be shared between concurrent requests, nor hold frames of coroutines
+// that outlive the request. The arena must outlive all of its allocations.
+class Arena {
+ public:
+#ifdef DIY_CORO_ARENAS
+  static constexpr bool kEnabled = true;
+#else
+  static constexpr bool kEnabled = false;
+#endif
+
+  static constexpr std::size_t kAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+  explicit Arena(std::size_t chunk_size = 64 * 1024)
+      : chunk_size_(chunk_size) {}
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // The arena that coroutine frames created by the calling thread are
+  // allocated from, if any. See ArenaScope.
+  static Arena* Current() { return kEnabled ? current_ : nullptr; }
+
+  // Allocates `size` bytes, aligned to kAlignment. Thread-safe.
+  void* Allocate(std::size_t size);
+
+  // Releases one allocation, resetting the arena if it was the last one.
+  // Thread-safe, but allocating concurrently with releasing the last
+  // allocation is not.
+  void Free() {
+    if (live_.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+      Reset();
+    }
+  }
+
+  // Number of allocations not yet freed.
+  std::size_t live() const { return live_.load(std::memory_order::relaxed); }
+
+  // Total size of all chunks.
+  std::size_t reserved_bytes() const;
+
+ private:
+  friend class ArenaScope;
+  template <bool Enabled>
+  friend class BasicArenaContext;
+
+  struct Chunk;
+
+  static inline thread_local Arena* current_ = nullptr;
+
+  void* AllocateSlow(std::size_t size, Chunk* full);
+  void Reset();
+
+  const std::size_t chunk_size_;
+  std::atomic_size_t live_ = 0;
+  // The chunk currently being allocated from. Chunks before it in the list are
+  // full, and chunks after it are empty.
+  std::atomic<Chunk*> current_chunk_ = nullptr;
+
+  // Guards adding chunks and moving to the next one.
+  mutable std::mutex mutex_;
+  std::unique_ptr<Chunk> chunks_;
+};
+
+struct Arena::Chunk {
+  std::unique_ptr<std::byte[]> data;
+  std::size_t size;
+  // Bytes handed out, or more once the chunk is full.
+  std::atomic_size_t used = 0;
+  std::unique_ptr<Chunk> next;
+};
+
+// Makes `arena` current on the calling thread for the lifetime of the scope.
+// Frames of Tasks and AsyncGenerators created while it is current are
+// allocated from `arena`, unless created with an explicit allocator. Such
+// coroutines make the arena current again whenever they run, so the frames of
+// coroutines they create are allocated from it too, on whichever thread.
+//
+//   Arena arena;
+//   Task<Response> task = [&] {
+//     ArenaScope scope(arena);
+//     return HandleRequest(std::move(request));
+//   }();
+//
+// The arena is reset once the last of these frames is destroyed; usually the
+// root task's, after it completes.
+class ArenaScope {
+ public:
+  explicit ArenaScope(Arena& arena) {
+    if constexpr (Arena::kEnabled) {
+      previous_ = std::exchange(Arena::current_, &arena);
+    }
+  }
+  ~ArenaScope() {
+    if constexpr (Arena::kEnabled) {
+      Arena::current_ = previous_;
+    }
+  }
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  Arena* previous_ = nullptr;
+};
+
+template <bool Enabled>
+class BasicArenaContext;
+
+// Embedded in promise types whose coroutines may run on other threads than
+// the one they were created on. Captures the current arena at creation, and
+// makes it current whenever the coroutine runs.
+using ArenaContext = BasicArenaContext<Arena::kEnabled>;
+
+template <>
+class BasicArenaContext<false> {
+ public:
+  // Returns `awaitable` unchanged.
+  template <typename A>
+  static decltype(auto) Wrap(A&& awaitable) {
+    return std::forward<A>(awaitable);
+  }
+
+  void Exit() const {}
+};
+
+template <>
+class BasicArenaContext<true> {
+ public:
+  BasicArenaContext() : arena_(Arena::current_), saved_(Arena::current_) {}
+
+  BasicArenaContext(const BasicArenaContext&) = delete;
+  BasicArenaContext& operator=(const BasicArenaContext&) = delete;
+
+  // Wraps `awaitable` so that our arena is current after the coroutine
+  // resumes from it, and the previous one is restored when it suspends.
+  template <typename A>
+  auto Wrap(A&& awaitable);
+
+  // Restores the previously current arena; for use when the coroutine body
+  // has finished.
+  void Exit() const { Arena::current_ = saved_; }
+
+ private:
+  template <typename A>
+  struct Awaiter;
+
+  void Enter() { saved_ = std::exchange(Arena::current_, arena_); }
+
+  Arena* const arena_;
+  // The arena that was current before the coroutine was last resumed, or when
+  // it was created.
+  Arena* saved_;
+};
+
+////////////////////
+// Implementation //
+////////////////////
+
+inline void* Arena::Allocate(std::size_t size) {
+  size = (size + kAlignment - 1) / kAlignment * kAlignment;
+  live_.fetch_add(1, std::memory_order::relaxed);
+  Chunk* chunk = current_chunk_.load(std::memory_order::acquire);
+  if (chunk != nullptr) {
+    const std::size_t offset =
+        chunk->used.fetch_add(size, std::memory_order::relaxed);
+    if (offset + size <= chunk->size) {
+      return chunk->data.get() + offset;
+    }
+  }
+  return AllocateSlow(size, chunk);
+}
+
+template <typename A>
+struct BasicArenaContext<true>::Awaiter {
+  A awaiter;
+  BasicArenaContext& context;
+  bool suspended = false;
+
+  bool await_ready() { return awaiter.await_ready(); }
+
+  template <typename P>
+  auto await_suspend(std::coroutine_handle<P> handle) {
+    // Restore before handing off, as the coroutine may be resumed on another
+    // thread before the call returns.
+    suspended = true;
+    context.Exit();
+    try {
+      return awaiter.await_suspend(handle);
+    } catch (...) {
+      // The exception is thrown into the coroutine, which carries on running.
+      context.Enter();
+      throw;
+    }
+  }
+
+  decltype(auto) await_resume() {
+    if (suspended) {
+      context.Enter();
+    }
+    return awaiter.await_resume();
+  }
+};
+
+template <typename A>
+auto BasicArenaContext<true>::Wrap(A&& awaitable) {
+  if constexpr (traits::IsIndirectlyAwaitable<A>) {
+    using Inner = traits::AwaiterType<A>;
+    return Awaiter<Inner>{
+        .awaiter = traits::ToAwaiter(std::forward<A>(awaitable)),
+        .context = *this};
+  } else {
+    return Awaiter<A>{.awaiter = std::forward<A>(awaitable), .context = *this};
+  }
+}
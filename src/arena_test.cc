@@ -0,0 +1,156 @@
+#include "diy/coro/arena.h"
+
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <coroutine>
+#include <stdexcept>
+#include <vector>
+
+#include "diy/coro/async_generator.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+using testing::ElementsAre;
+
+TEST(ArenaTest, ReusesMemoryWhenEmpty) {
+  Arena arena(1024);
+  void* a = arena.Allocate(100);
+  void* b = arena.Allocate(100);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(arena.live(), 2);
+
+  arena.Free();
+  arena.Free();
+  EXPECT_EQ(arena.live(), 0);
+  EXPECT_EQ(arena.Allocate(100), a);
+  arena.Free();
+  EXPECT_EQ(arena.reserved_bytes(), 1024);
+}
+
+TEST(ArenaTest, AddsChunks) {
+  Arena arena(1024);
+  arena.Allocate(1000);
+  arena.Allocate(1000);
+  EXPECT_EQ(arena.reserved_bytes(), 2048);
+  // Oversized allocations get a chunk of their own.
+  arena.Allocate(4096);
+  EXPECT_EQ(arena.reserved_bytes(), 2048 + 4096);
+  arena.Free();
+  arena.Free();
+  arena.Free();
+}
+
+TEST(ArenaTest, AllocatesFramesInScope) {
+  if (!Arena::kEnabled) {
+    GTEST_SKIP() << "Built without DIY_CORO_ARENAS";
+  }
+  Arena arena;
+  {
+    Task<int> task = [&] {
+      ArenaScope scope(arena);
+      EXPECT_EQ(Arena::Current(), &arena);
+      return []() -> Task<int> { co_return 1; }();
+    }();
+    EXPECT_EQ(Arena::Current(), nullptr);
+    EXPECT_EQ(arena.live(), 1);
+
+    Task<int> other = []() -> Task<int> { co_return 2; }();
+    EXPECT_EQ(arena.live(), 1);
+
+    EXPECT_EQ(std::move(task).Wait(), 1);
+    EXPECT_EQ(std::move(other).Wait(), 2);
+  }
+  EXPECT_EQ(arena.live(), 0);
+}
+
+TEST(ArenaTest, InheritedAcrossThreads) {
+  if (!Arena::kEnabled) {
+    GTEST_SKIP() << "Built without DIY_CORO_ARENAS";
+  }
+  Arena arena;
+  SerialExecutor executor;
+  std::size_t nested_live = 0;
+  auto body = [&]() -> Task<> {
+    co_await executor.Schedule();
+    EXPECT_EQ(Arena::Current(), &arena);
+    auto gen = []() -> AsyncGenerator<int> {
+      co_yield 1;
+      co_yield 2;
+    }();
+    std::vector<int> values;
+    while (int* value = co_await gen) {
+      values.push_back(*value);
+    }
+    EXPECT_THAT(values, ElementsAre(1, 2));
+    co_await [&]() -> Task<> {
+      nested_live = arena.live();
+      co_return;
+    }();
+  };
+  {
+    Task<> task = [&] {
+      ArenaScope scope(arena);
+      return body();
+    }();
+    std::move(task).Wait();
+  }
+  // This task, the generator and the nested task.
+  EXPECT_EQ(nested_live, 3);
+  // The executor thread may still hold a reference to the task's frame.
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (arena.live() != 0 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(arena.live(), 0);
+}
+
+TEST(ArenaTest, RestoresPreviousArenaOnSuspend) {
+  if (!Arena::kEnabled) {
+    GTEST_SKIP() << "Built without DIY_CORO_ARENAS";
+  }
+  Arena arena;
+  SerialExecutor executor;
+  auto body = [&]() -> Task<> { co_await executor.Schedule(); };
+  {
+    Task<> task = [&] {
+      ArenaScope scope(arena);
+      return body();
+    }();
+    std::move(task).Wait();
+  }
+  // The executor thread is no longer running the task.
+  auto current = [&]() -> Task<Arena*> {
+    co_await executor.Schedule();
+    co_return Arena::Current();
+  };
+  EXPECT_EQ(current().Wait(), nullptr);
+}
+
+TEST(ArenaTest, CurrentAfterAwaitSuspendThrows) {
+  if (!Arena::kEnabled) {
+    GTEST_SKIP() << "Built without DIY_CORO_ARENAS";
+  }
+  struct ThrowingAwaiter : std::suspend_always {
+    void await_suspend(std::coroutine_handle<>) {
+      throw std::runtime_error("error");
+    }
+  };
+
+  Arena arena;
+  auto body = [&]() -> Task<Arena*> {
+    try {
+      co_await ThrowingAwaiter();
+    } catch (const std::runtime_error&) {
+    }
+    co_return Arena::Current();
+  };
+  Task<Arena*> task = [&] {
+    ArenaScope scope(arena);
+    return body();
+  }();
+  EXPECT_EQ(std::move(task).Wait(), &arena);
+  EXPECT_EQ(Arena::Current(), nullptr);
+}
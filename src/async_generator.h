@@ -8,8 +8,12 @@
 #include <type_traits>
 #include <vector>
 
+#include "diy/coro/arena.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/frame_allocator.h"
 #include "diy/coro/handle.h"
 #include "diy/coro/task.h"
+#include "diy/coro/trace.h"
 #include "diy/coro/traits.h"
 
 // Coroutine type for asynchronously producing a sequence of values of unknown
@@ -104,7 +108,8 @@ AsyncGenerator<T>::AsyncGenerator(R&& range)
       }(std::forward<R>(range))) {}
 
 template <typename T>
-struct AsyncGenerator<T>::Promise {
+struct AsyncGenerator<T>::Promise
+    : frame_allocator::AllocatedFrame<Promise> {
   // Value currently being yielded by the coroutine body. This is set during
   // co_yield and reset during co_await.
   T* value = nullptr;
@@ -117,12 +122,17 @@ struct AsyncGenerator<T>::Promise {
   std::coroutine_handle<> parent;
   std::coroutine_handle<> generator_handle;
 
+  [[no_unique_address]] trace::FrameTracer tracer{"AsyncGenerator"};
+  [[no_unique_address]] ArenaContext arena_context;
+
   AsyncGenerator<T> get_return_object() {
     generator_handle = std::coroutine_handle<Promise>::from_promise(*this);
     return AsyncGenerator<T>(Handle(generator_handle));
   }
 
-  std::suspend_always initial_suspend() { return {}; }
+  auto initial_suspend() {
+    return arena_context.Wrap(trace::Traced(std::suspend_always(), tracer));
+  }
 
   // Awaitable created in the generator coroutine that context switches into the
   // parent coroutine's body.
@@ -144,6 +154,8 @@ struct AsyncGenerator<T>::Promise {
   // it that we've reached the end of the sequence.
   auto final_suspend() noexcept {
     exhausted = true;
+    tracer.Complete();
+    arena_context.Exit();
     return Yield();
   }
 
@@ -155,7 +167,7 @@ struct AsyncGenerator<T>::Promise {
   auto yield_value(T& new_value) {
     assert(value == nullptr);
     value = &new_value;
-    return Yield();
+    return arena_context.Wrap(trace::Traced(Yield(), tracer));
   }
 
   // Note: Even though this overload directly matches against T&&, it will also
@@ -176,9 +188,14 @@ struct AsyncGenerator<T>::Promise {
     return Awaiter{.promise = this};
   }
 
+  // As Task's.
   template <typename U>
   decltype(auto) await_transform(U&& x) {
-    return std::forward<U>(x);
+    if constexpr (Arena::kEnabled) {
+      return arena_context.Wrap(trace::Traced(std::forward<U>(x), tracer));
+    } else {
+      return trace::Traced(std::forward<U>(x), tracer);
+    }
   }
 };
 
@@ -196,8 +213,15 @@ traits::HasAwaitResult<T*> auto AsyncGenerator<T>::operator co_await() {
 
     std::coroutine_handle<> await_suspend(
         std::coroutine_handle<> parent) noexcept {
-      generator->promise().parent = parent;
-      return generator->promise().generator_handle;
+      Promise& promise = generator->promise();
+      promise.parent = parent;
+      if (Executor::ConsumeSliceBudget()) {
+        // Let the executor's other coroutines run before producing the next
+        // value.
+        Executor::Current()->Enqueue(promise.generator_handle);
+        return std::noop_coroutine();
+      }
+      return promise.generator_handle;
     }
 
     T* await_resume() {
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "benchmark_util.h"
+#include "diy/coro/async_queue.h"
+#include "diy/coro/executor.h"
+
+using Clock = LatencyRecorder::Clock;
+
+// Time from Push() on the benchmark thread to the consumer running on its own
+// executor. One value is in flight at a time.
+static void BM_AsyncQueuePushToResume(benchmark::State& state) {
+  auto consume = [](SerialExecutor& executor,
+                    AsyncGenerator<Clock::time_point> values,
+                    LatencyRecorder& latencies,
+                    std::atomic_int64_t& consumed) -> Detached {
+    co_await executor.Schedule();
+    while (true) {
+      const Clock::time_point* pushed = co_await values;
+      // Push() resumes us inline on the pushing thread.
+      co_await executor.Schedule();
+      if (*pushed == Clock::time_point::max()) {
+        break;
+      }
+      latencies.Record(Clock::now() - *pushed);
+      consumed.fetch_add(1, std::memory_order::release);
+    }
+    consumed.store(-1, std::memory_order::release);
+  };
+
+  SerialExecutor executor;
+  AsyncQueue<Clock::time_point> queue;
+  LatencyRecorder latencies(1 << 20);
+  std::atomic_int64_t consumed = 0;
+  consume(executor, queue.Values(), latencies, consumed);
+
+  std::int64_t pushed = 0;
+  for (auto _ : state) {
+    queue.Push(Clock::now());
+    ++pushed;
+    SpinUntil(
+        [&] { return consumed.load(std::memory_order::acquire) == pushed; });
+  }
+  queue.Push(Clock::time_point::max());
+  SpinUntil([&] { return consumed.load(std::memory_order::acquire) == -1; });
+  latencies.Report(state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_AsyncQueuePushToResume)->UseRealTime();
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "diy/coro/task.h"
+
+// Helpers shared by the *_benchmark.cc binaries. Not part of the library.
+
+// Lets a benchmark start many concurrent coroutines without waiting on each
+// of them.
+using task_internal::Detached;
+
+// Busy-waits until `done()` returns true. Yields between checks so that the
+// thread being waited on gets to run even on machines with few cores.
+template <typename F>
+void SpinUntil(F done) {
+  while (!done()) {
+    std::this_thread::yield();
+  }
+}
+
+// Collects latency samples and reports their distribution as benchmark
+// counters, so that they show up in the JSON output alongside the timings.
+class LatencyRecorder {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit LatencyRecorder(std::size_t expected_samples) {
+    samples_.reserve(expected_samples);
+  }
+
+  void Record(Clock::duration latency) { samples_.push_back(latency); }
+
+  // Sets p50/p90/p99/p999/max counters (in nanoseconds) on `state`.
+  void Report(benchmark::State& state) {
+    if (samples_.empty()) {
+      return;
+    }
+    std::sort(samples_.begin(), samples_.end());
+    auto percentile = [&](double p) {
+      const std::size_t index = static_cast<std::size_t>(
+          p * static_cast<double>(samples_.size() - 1));
+      return static_cast<double>(
+          std::chrono::nanoseconds(samples_[index]).count());
+    };
+    state.counters["p50_ns"] = percentile(0.5);
+    state.counters["p90_ns"] = percentile(0.9);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+    state.counters["max_ns"] = percentile(1.0);
+  }
+
+ private:
+  std::vector<Clock::duration> samples_;
+};
@@ -0,0 +1,144 @@
+#include "diy/coro/blocking_pool.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "diy/coro/executor_internal.h"
+#include "diy/coro/histogram.h"
+
+using executor_internal::NowNanos;
+
+struct BlockingPool::SharedState {
+  struct Pending {
+    std::coroutine_handle<> handle;
+    // NowNanos() at the time of Enqueue().
+    std::int64_t enqueued_at;
+  };
+
+  const Options options;
+
+  std::mutex mutex;
+  // Signalled when work is queued, and on stopping.
+  std::condition_variable work_available;
+  std::deque<Pending> queue;
+  // Number of started threads, and how many of them are waiting for work.
+  std::size_t threads = 0;
+  std::size_t idle = 0;
+  bool stopping = false;
+  // The pool, for Executor::Current(), until it is destroyed. The threads may
+  // outlive it.
+  Executor* pool;
+
+  // Metrics, summed over all threads. Only accessed with `mutex` held, which
+  // also makes each histogram single-writer.
+  std::uint64_t enqueued = 0;
+  std::uint64_t resumed = 0;
+  std::uint64_t parks = 0;
+  std::int64_t parked_ns = 0;
+  Histogram schedule_delay_ns;
+  Histogram slice_ns;
+  Histogram queue_depth;
+
+  SharedState(Options options, Executor* pool)
+      : options(options), pool(pool) {}
+
+  void Run() {
+    auto lock = std::unique_lock(mutex);
+    while (true) {
+      if (!queue.empty()) {
+        const Pending pending = queue.front();
+        queue_depth.Record(queue.size());
+        queue.pop_front();
+        current_ = pool;
+        lock.unlock();
+        const std::int64_t start = NowNanos();
+        pending.handle.resume();
+        const std::int64_t end = NowNanos();
+        lock.lock();
+        schedule_delay_ns.Record(start - pending.enqueued_at);
+        slice_ns.Record(end - start);
+        ++resumed;
+        continue;
+      }
+      if (stopping) {
+        break;
+      }
+      ++idle;
+      ++parks;
+      const std::int64_t parked_at = NowNanos();
+      const bool woken = work_available.wait_for(
+          lock, absl::ToChronoNanoseconds(options.idle_timeout),
+          [&] { return !queue.empty() || stopping; });
+      parked_ns += NowNanos() - parked_at;
+      --idle;
+      if (!woken) {
+        break;
+      }
+    }
+    --threads;
+  }
+};
+
+BlockingPool::BlockingPool(Options options)
+    : state_(std::make_shared<SharedState>(options, this)) {}
+
+BlockingPool::~BlockingPool() {
+  if (IsCurrent()) {
+    // Destroyed by one of our own coroutines, which carries on without us.
+    current_ = nullptr;
+  }
+  {
+    auto lock = std::lock_guard(state_->mutex);
+    state_->stopping = true;
+    state_->pool = nullptr;
+  }
+  state_->work_available.notify_all();
+}
+
+BlockingPool& BlockingPool::Default() {
+  // Never destroyed, so that it outlives any static executors using it.
+  static BlockingPool* const pool = new BlockingPool;
+  return *pool;
+}
+
+void BlockingPool::Enqueue(std::coroutine_handle<> handle) {
+  bool start_thread = false;
+  {
+    const std::int64_t now = NowNanos();
+    auto lock = std::lock_guard(state_->mutex);
+    state_->queue.push_back({.handle = handle, .enqueued_at = now});
+    ++state_->enqueued;
+    // Start a thread unless there's an idle one for each queued coroutine.
+    if (state_->queue.size() > state_->idle &&
+        state_->threads < state_->options.max_threads) {
+      ++state_->threads;
+      start_thread = true;
+    }
+  }
+  if (start_thread) {
+    std::thread([state = state_] { state->Run(); }).detach();
+  } else {
+    state_->work_available.notify_one();
+  }
+}
+
+std::size_t BlockingPool::threads() const {
+  auto lock = std::lock_guard(state_->mutex);
+  return state_->threads;
+}
+
+ExecutorMetrics BlockingPool::Metrics() const {
+  auto lock = std::lock_guard(state_->mutex);
+  return {
+      .enqueued = state_->enqueued,
+      .resumed = state_->resumed,
+      .parks = state_->parks,
+      .parked_time = absl::Nanoseconds(state_->parked_ns),
+      .schedule_delay_ns = state_->schedule_delay_ns.TakeSnapshot(),
+      .slice_ns = state_->slice_ns.TakeSnapshot(),
+      .queue_depth = state_->queue_depth.TakeSnapshot(),
+  };
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <absl/time/time.h>
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+// Executor for coroutines that make blocking calls. Each coroutine scheduled
+// onto the pool gets a thread of its own, up to a maximum, beyond which work
+// is queued until a thread is free. Threads are started on demand and exit
+// after being idle for a while.
+//
+// Usually used through Offload().
+class BlockingPool : public Executor {
+ public:
+  struct Options {
+    std::size_t max_threads = 64;
+    // How long a thread waits for more work before exiting.
+    absl::Duration idle_timeout = absl::Seconds(10);
+  };
+
+  explicit BlockingPool(Options options);
+  BlockingPool() : BlockingPool(Options()) {}
+  // Work already scheduled onto the pool still runs after destruction.
+  ~BlockingPool() override;
+
+  // Shared pool with default options, for use by Offload().
+  static BlockingPool& Default();
+
+  void Enqueue(std::coroutine_handle<> handle) override;
+  bool IsCurrent() const override { return Current() == this; }
+  // Summed over all of the pool's threads. A park is a thread waiting idle
+  // for work, whether or not it then exits.
+  ExecutorMetrics Metrics() const override;
+
+  // Number of threads currently started.
+  std::size_t threads() const;
+
+ private:
+  struct SharedState;
+
+  // Shared with the threads, which may outlive the pool.
+  std::shared_ptr<SharedState> state_;
+};
+
+// Calls `fn` on `pool`, and then resumes the awaiting coroutine on the
+// executor it was running on, with the result or exception of `fn`. Keeps
+// blocking calls from stalling the awaiting coroutine's executor:
+//
+//   co_await executor.Schedule();
+//   const int fd = co_await Offload([&] { return ::open(path, O_RDONLY); });
+//
+// If the awaiting coroutine wasn't running on an executor, it stays on the
+// pool's thread. `fn` must return by value, as a Task can't hold a reference.
+template <std::invocable F>
+  requires(!std::is_reference_v<std::invoke_result_t<F>>)
+Task<std::invoke_result_t<F>> Offload(
+    F fn, BlockingPool& pool = BlockingPool::Default());
+
+////////////////////
+// Implementation //
+////////////////////
+
+template <std::invocable F>
+  requires(!std::is_reference_v<std::invoke_result_t<F>>)
+Task<std::invoke_result_t<F>> Offload(F fn, BlockingPool& pool) {
+  using Result = std::invoke_result_t<F>;
+  Executor* const origin = Executor::Current();
+  co_await pool.Schedule();
+  // The exception is only rethrown after returning to `origin`.
+  std::exception_ptr exception;
+  if constexpr (std::is_void_v<Result>) {
+    try {
+      fn();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    if (origin != nullptr) {
+      co_await origin->Schedule();
+    }
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  } else {
+    std::optional<Result> result;
+    try {
+      result.emplace(fn());
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    if (origin != nullptr) {
+      co_await origin->Schedule();
+    }
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    co_return std::move(*result);
+  }
+}
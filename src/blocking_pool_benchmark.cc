@@ -0,0 +1,24 @@
+#include <benchmark/benchmark.h>
+
+#include "diy/coro/blocking_pool.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+constexpr int kBatchSize = 1'000;
+
+// Cost of a round trip from an executor to the pool and back.
+static void BM_OffloadRoundTrip(benchmark::State& state) {
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+    for (int i = 0; i < kBatchSize; ++i) {
+      benchmark::DoNotOptimize(co_await Offload([] { return 1; }));
+    }
+  };
+  SerialExecutor executor;
+  for (auto _ : state) {
+    task(executor).Wait();
+  }
+  state.SetItemsProcessed(kBatchSize * state.iterations());
+}
+
+BENCHMARK(BM_OffloadRoundTrip)->UseRealTime();
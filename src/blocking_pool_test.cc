@@ -0,0 +1,128 @@
+#include "diy/coro/blocking_pool.h"
+
+#include <absl/synchronization/notification.h>
+#include <absl/time/clock.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+TEST(BlockingPoolTest, ResumesOnOriginalExecutor) {
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+    const std::thread::id offloaded_id = co_await Offload([&] {
+      EXPECT_FALSE(executor.IsCurrent());
+      return std::this_thread::get_id();
+    });
+    EXPECT_TRUE(executor.IsCurrent());
+    EXPECT_NE(offloaded_id, std::this_thread::get_id());
+  };
+
+  SerialExecutor executor;
+  task(executor).Wait();
+}
+
+TEST(BlockingPoolTest, ExceptionRethrownOnOriginalExecutor) {
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+    EXPECT_THROW(co_await Offload([] { throw std::runtime_error("error"); }),
+                 std::runtime_error);
+    EXPECT_TRUE(executor.IsCurrent());
+  };
+
+  SerialExecutor executor;
+  task(executor).Wait();
+}
+
+TEST(BlockingPoolTest, CurrentExecutor) {
+  BlockingPool pool;
+  EXPECT_EQ(Executor::Current(), nullptr);
+  auto task = [](BlockingPool& pool) -> Task<Executor*> {
+    co_await pool.Schedule();
+    co_return Executor::Current();
+  };
+  EXPECT_EQ(task(pool).Wait(), &pool);
+}
+
+TEST(BlockingPoolTest, DestroyedByOwnCoroutine) {
+  auto task = []() -> Task<int> {
+    std::optional<BlockingPool> pool;
+    pool.emplace();
+    co_await pool->Schedule();
+    pool.reset();
+    EXPECT_EQ(Executor::Current(), nullptr);
+    // Would otherwise try to return to the destroyed pool.
+    co_return co_await Offload([] { return 1; });
+  };
+
+  EXPECT_EQ(task().Wait(), 1);
+}
+
+TEST(BlockingPoolTest, Metrics) {
+  BlockingPool pool;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(Offload([] { return 1; }, pool).Wait(), 1);
+  }
+  // Wait() may return before the thread has accounted for the coroutine.
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (pool.Metrics().resumed < 3 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  const ExecutorMetrics metrics = pool.Metrics();
+  EXPECT_EQ(metrics.enqueued, 3);
+  EXPECT_EQ(metrics.resumed, 3);
+  EXPECT_EQ(metrics.schedule_delay_ns.count(), 3);
+  EXPECT_EQ(metrics.slice_ns.count(), 3);
+  EXPECT_EQ(metrics.queue_depth.count(), 3);
+}
+
+template <typename F>
+concept Offloadable = requires(F fn) { Offload(fn); };
+
+// Tasks can't hold references.
+static_assert(Offloadable<int (*)()>);
+static_assert(!Offloadable<int& (*)()>);
+
+TEST(BlockingPoolTest, QueuesBeyondMaxThreads) {
+  BlockingPool pool({.max_threads = 2});
+  std::atomic_int running = 0;
+  absl::Notification release;
+  auto block = [&] {
+    EXPECT_LE(++running, 2);
+    release.WaitForNotification();
+    --running;
+  };
+
+  std::vector<std::jthread> callers;
+  for (int i = 0; i < 5; ++i) {
+    callers.emplace_back([&] { Offload(block, pool).Wait(); });
+  }
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (running < 2 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  // Give any excess threads a chance to start.
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_EQ(running, 2);
+  EXPECT_EQ(pool.threads(), 2);
+  release.Notify();
+}
+
+TEST(BlockingPoolTest, IdleThreadsExit) {
+  BlockingPool pool({.idle_timeout = absl::Milliseconds(10)});
+  EXPECT_EQ(Offload([] { return 1; }, pool).Wait(), 1);
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (pool.threads() > 0 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(pool.threads(), 0);
+  // A new thread is started on demand.
+  EXPECT_EQ(Offload([] { return 2; }, pool).Wait(), 2);
+}
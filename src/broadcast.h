@@ -1,205 +1,665 @@
 #pragma once
 
-#include <absl/log/log.h>
-#include <absl/synchronization/mutex.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <cassert>
 #include <coroutine>
-#include <iterator>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <limits>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <optional>
-#include <queue>
-#include <ranges>
-#include <stdexcept>
-#include <variant>
+#include <utility>
+#include <vector>
 
 #include "diy/coro/async_generator.h"
-#include "diy/coro/task.h"
+#include "diy/coro/executor.h"
 #include "diy/coro/traits.h"
 
 // Single-publisher multiple-subscriber message dispatching network.
 //
-// TODO(dhrosa): Exceptions raiesd by `publisher` currently work correctly for
-// single subscribers, but not multiple.
+// Values produced by the publisher are written exactly once into a slot taken
+// from a pool owned by the broadcast, and every subscriber reads them in-place
+// from there. A fixed-size ring maps the most recent sequence numbers to their
+// slots; each subscriber only tracks its own position within the stream. Slots
+// are reference counted and return to the pool once neither the ring nor any
+// subscriber refers to them, so steady-state publishing doesn't allocate.
+// How a subscriber that falls behind affects the publisher is determined by its
+// SlowSubscriberPolicy. Optionally, the most recent values are replayed to new
+// subscribers straight out of the ring before they receive live values.
+//
+// By default subscribers run on whichever thread wakes them up. Subscribers
+// that are pinned to an Executor instead always run there, which lets
+// subscribers process values in parallel while the publisher reads ahead.
 template <typename T>
 class Broadcast {
  public:
+  static constexpr std::size_t kDefaultCapacity = 64;
+
+  // What happens when a subscriber falls `SubscribeOptions::max_lag` values
+  // behind the publisher.
+  enum class SlowSubscriberPolicy {
+    // The publisher is not read from until the subscriber catches up.
+    kBlock,
+    // The oldest unconsumed values are skipped. The publisher is never held
+    // back; the value currently held by the subscriber's caller is kept alive
+    // until it moves on.
+    kDropOldest,
+    // Only the most recently published value is kept; equivalent to
+    // kDropOldest with `max_lag` of 1.
+    kConflate,
+  };
+
+  // Statistics for a single subscriber. Updated with relaxed atomics, so values
+  // read concurrently with the subscription are only approximate.
+  struct SubscriberCounters {
+    // Number of values yielded to the subscriber.
+    std::atomic_uint64_t consumed = 0;
+    // Number of values skipped under kDropOldest or kConflate.
+    std::atomic_uint64_t dropped = 0;
+    // Number of separate occasions on which values were skipped.
+    std::atomic_uint64_t gaps = 0;
+    // Number of values the subscriber was behind the publisher when it
+    // consumed its most recent value.
+    std::atomic_uint64_t lag = 0;
+    // Largest value of `lag` observed so far.
+    std::atomic_uint64_t max_lag = 0;
+    // Number of times the publisher was held back by this subscriber.
+    std::atomic_uint64_t publisher_stalls = 0;
+  };
+
+  struct SubscribeOptions {
+    SlowSubscriberPolicy policy = SlowSubscriberPolicy::kBlock;
+    // The number of values the subscriber may fall behind by before `policy`
+    // takes effect. Clamped to the capacity of the broadcast.
+    std::size_t max_lag = std::numeric_limits<std::size_t>::max();
+    // If set, updated as the subscription progresses.
+    std::shared_ptr<SubscriberCounters> counters;
+    // If set, the subscription starts on this executor, and is woken up on it
+    // when new values arrive instead of on the thread that published them.
+    // Must outlive the subscription.
+    Executor* executor = nullptr;
+  };
+
+  struct Options {
+    // At most this many values (rounded up to a power of two) are buffered for
+    // subscribers that have fallen behind.
+    std::size_t capacity = kDefaultCapacity;
+    // Number of most recently published values that a new subscriber receives
+    // before any live values. Clamped to `capacity - 1`.
+    std::size_t replay_count = 0;
+    // If set, values published longer than this ago are not replayed.
+    absl::Duration replay_age = absl::InfiniteDuration();
+    // Maximum number of values read from the publisher in one go, space
+    // permitting. Values are published (and waiting subscribers woken up) as
+    // soon as each one is read.
+    std::size_t read_ahead = 1;
+  };
+
   // The values produced by `publisher` will be fanned out to all of the
   // subscribers.
-  Broadcast(AsyncGenerator<T>&& publisher)
-      : state_{.publisher = std::move(publisher)} {}
+  Broadcast(AsyncGenerator<T>&& publisher, Options options);
+  Broadcast(AsyncGenerator<T>&& publisher,
+            std::size_t capacity = kDefaultCapacity);
 
   // Registers a new subscriber with the broadcast; the values yielded by this
-  // generator will be the same stream of values produced by `publisher`. All
-  // call to Subscribe() must be done before awaiting on a value from any
-  // previously created subscribers; i.e. subscribers can only be registered
-  // around creation time.
+  // generator will be the stream of values produced by `publisher`, starting
+  // with the replayed values (if any), followed by the first value published
+  // after this call. Subscribers may be registered at any time, from any
+  // thread.
+  //
+  // Destroying the returned generator unregisters the subscriber, so that it no
+  // longer holds back the publisher. The generator must not outlive the
+  // broadcast, and must not be destroyed while it is being awaited.
   AsyncGenerator<const T> Subscribe();
+  AsyncGenerator<const T> Subscribe(SubscribeOptions options);
 
  private:
   struct State;
   struct Subscriber;
-
-  // Values can either be a shared reference to a value yielded by `publisher`,
-  // an end-of-stream "Exhausted" signal, or an exception raised by `publisher`.
-  struct Exhausted {};
-  using Value =
-      std::variant<std::shared_ptr<const T>, Exhausted, std::exception_ptr>;
+  struct Slot;
+  class Registration;
 
   State state_;
 };
 
+template <typename T>
+struct Broadcast<T>::Slot {
+  // Empty until the first time the publisher writes to this slot. Afterwards
+  // values are assigned in-place so that any storage owned by `T` can be
+  // reused.
+  std::optional<T> value;
+  // Only recorded if Options::replay_age is set.
+  absl::Time published_at;
+  // Number of references from the ring and from non-blocking subscribers.
+  // Blocking subscribers don't need their own reference; gating ensures the
+  // ring still refers to any value they may read.
+  std::atomic_uint32_t refs = 0;
+  // Next entry in State::released or State::spare.
+  Slot* next_free = nullptr;
+};
+
 template <typename T>
 struct Broadcast<T>::Subscriber {
-  // Yields to the subscriber's corresponding Subscribe() coroutine. This is set
-  // once State::Subscription() starts.
-  std::optional<typename AsyncGenerator<const T>::Yielder> yielder;
+  static constexpr std::uint64_t kUngated =
+      std::numeric_limits<std::uint64_t>::max();
+
+  Subscriber(SubscribeOptions options, std::size_t capacity,
+             std::uint64_t start)
+      : blocking(options.policy == SlowSubscriberPolicy::kBlock),
+        max_lag(options.policy == SlowSubscriberPolicy::kConflate
+                    ? 1
+                    : std::clamp<std::size_t>(options.max_lag, 1, capacity)),
+        counters(std::move(options.counters)),
+        executor(options.executor),
+        cursor(start) {}
+
+  // If false, this subscriber skips values instead of holding back the
+  // publisher.
+  const bool blocking;
+  const std::uint64_t max_lag;
+  const std::shared_ptr<SubscriberCounters> counters;
+  Executor* const executor;
+
+  // Sequence number of the next value this subscriber will consume. While the
+  // subscriber is suspended in co_yield this is the sequence number of the
+  // value held by the caller.
+  std::atomic_uint64_t cursor;
+  // For non-blocking subscribers; the slot of the value at `cursor` while the
+  // caller holds it. We own a reference to it.
+  Slot* held = nullptr;
 
-  // Coroutine waiting on NextValue().
-  std::coroutine_handle<> waiting;
+  // The subscription coroutine, while it is suspended in State::waiting.
+  std::coroutine_handle<> suspended;
 
-  // Values not yet consumed by this subscriber.
-  std::queue<Value> values;
+  // The lowest sequence number that this subscriber does not allow to be
+  // published yet.
+  std::uint64_t Gate() const {
+    if (!blocking) {
+      return kUngated;
+    }
+    return cursor.load(std::memory_order::seq_cst) + max_lag;
+  }
+
+  void RecordConsume(std::uint64_t lag) {
+    if (!counters) {
+      return;
+    }
+    counters->consumed.fetch_add(1, std::memory_order::relaxed);
+    counters->lag.store(lag, std::memory_order::relaxed);
+    if (lag > counters->max_lag.load(std::memory_order::relaxed)) {
+      counters->max_lag.store(lag, std::memory_order::relaxed);
+    }
+  }
+
+  void RecordDrop(std::uint64_t count) {
+    if (!counters) {
+      return;
+    }
+    counters->dropped.fetch_add(count, std::memory_order::relaxed);
+    counters->gaps.fetch_add(1, std::memory_order::relaxed);
+  }
+
+  void RecordStall() {
+    if (counters) {
+      counters->publisher_stalls.fetch_add(1, std::memory_order::relaxed);
+    }
+  }
+};
+
+// Owns a subscriber's entry in State::subscribers, and removes it on
+// destruction. This is passed by value to State::Subscription() so that the
+// subscriber is removed when the coroutine frame is destroyed, even if the
+// coroutine body never started.
+template <typename T>
+class Broadcast<T>::Registration {
+ public:
+  Registration(State& state, typename std::list<Subscriber>::iterator it)
+      : state_(&state), it_(it) {}
+
+  Registration(Registration&& other) noexcept
+      : state_(std::exchange(other.state_, nullptr)), it_(other.it_) {}
+  Registration& operator=(Registration&&) = delete;
+
+  ~Registration() {
+    if (state_) {
+      state_->Unsubscribe(it_);
+    }
+  }
+
+  Subscriber& operator*() const { return *it_; }
+
+ private:
+  State* state_;
+  typename std::list<Subscriber>::iterator it_;
 };
 
 template <typename T>
 struct Broadcast<T>::State {
   AsyncGenerator<T> publisher;
-  // Synchronizes access to `read_in_progress` and elements of `subscribers`.
+  // Owns every slot. Only grown by the current reader, when it runs out of free
+  // slots because non-blocking subscribers are holding on to slots that have
+  // left the ring.
+  std::deque<Slot> pool;
+  // Ring of published values. Sequence number `s` is stored in
+  // `*ring[s & mask]`. Each non-null entry owns a reference to its slot.
+  std::vector<Slot*> ring;
+  std::uint64_t mask;
+  std::uint64_t replay_count;
+  absl::Duration replay_age;
+  std::uint64_t read_ahead;
+
+  // Number of values published so far; i.e. the sequence number of the next
+  // value. Only modified while holding `mutex`, but may be read without it.
+  std::atomic_uint64_t published = 0;
+  // Slots whose last reference was dropped, pushed from any thread. Only the
+  // current reader pops from it (all at once), so there's no ABA hazard.
+  std::atomic<Slot*> released = nullptr;
+  // Free slots owned by the current reader.
+  Slot* spare = nullptr;
+  // Set when a read from `publisher` was prevented by a slow subscriber.
+  // Subscribers wake up `waiting` when they move past a value while this is
+  // set.
+  std::atomic_bool gated = false;
+
+  // Synchronizes access to the remaining fields, as well as the slow path of
+  // each subscriber.
   std::mutex mutex;
   // Set when we're in the process of getting a new value from `publisher`.
   bool read_in_progress = false;
-  // We use a list instead of vector for pointer-stability in Subscribe().
+  // Lower bound on Subscriber::Gate() across all subscribers. Only recomputed
+  // when it would prevent publishing, so that publishing is usually O(1) in
+  // the number of subscribers.
+  std::uint64_t gate = Subscriber::kUngated;
+  // Sequence number at which `publisher` finished, if it has.
+  std::optional<std::uint64_t> end;
+  // The exception raised by `publisher`, if any.
+  std::exception_ptr exception;
+  // We use a list instead of vector for pointer-stability across concurrent
+  // Subscribe() and Unsubscribe() calls.
   std::list<Subscriber> subscribers;
+  // Subscribers waiting for a new value or for free space in the ring.
+  std::vector<Subscriber*> waiting;
 
-  // Main loop for each subscriber.
-  AsyncGenerator<const T> Subscription(Subscriber& subscriber) {
-    subscriber.yielder = co_await AsyncGenerator<const T>::GetYielder();
-    while (co_await SubscriptionRound(subscriber)) {
-    }
-  }
-
-  enum ConsumeResult {
-    // This task should fetch a new value from upstream to publish to the other
-    // subscribers.
-    kReadNewValue,
-    // An upstream read is in-progess and this task should wait for another task
-    // to complete the read.
-    kWaitForNewValue,
+  enum Action {
+    // A value is available at the subscriber's cursor.
+    kConsume,
+    // This subscriber should fetch a new value from upstream to publish to the
+    // other subscribers.
+    kRead,
+    // No progress is possible until another subscriber acts.
+    kWait,
     // No more values will arrive from upstream; generator should exit.
     kExhausted,
   };
 
-  // Yield all pending values to the caller. Returns `true` if this subscriber
-  // should fetch a new value upstream to publish to the other subscribers for
-  // the next round.
-  Task<ConsumeResult> ConsumeAllCurrentValues(Subscriber& subscriber) {
+  // Main loop for each subscriber.
+  AsyncGenerator<const T> Subscription(Registration registration) {
+    Subscriber& subscriber = *registration;
+    if (subscriber.executor) {
+      co_await subscriber.executor->Schedule();
+    }
     while (true) {
-      Value variant = Exhausted{};
-      {
-        auto lock = std::lock_guard(mutex);
-        if (subscriber.values.empty()) {
-          if (read_in_progress) {
-            co_return kWaitForNewValue;
+      const Action action = co_await NextAction(subscriber);
+      // Non-blocking subscribers may have skipped ahead in NextAction().
+      const std::uint64_t sequence =
+          subscriber.cursor.load(std::memory_order::relaxed);
+      switch (action) {
+        case kConsume: {
+          const Slot& slot =
+              subscriber.held ? *subscriber.held : *ring[sequence & mask];
+          co_yield *slot.value;
+          Release(subscriber, sequence + 1);
+          break;
+        }
+        case kRead: {
+          for (std::uint64_t reads = 1;; ++reads) {
+            const std::uint64_t next =
+                published.load(std::memory_order::relaxed);
+            std::exception_ptr error;
+            T* value = nullptr;
+            try {
+              value = co_await publisher;
+            } catch (...) {
+              error = std::current_exception();
+            }
+            if (value) {
+              Slot& slot = AcquireSlot();
+              slot.value = std::move(*value);
+              if (replay_age != absl::InfiniteDuration()) {
+                slot.published_at = absl::Now();
+              }
+              // The gating checks in Poll() and Publish() guarantee that no
+              // blocking subscriber still needs the entry we're replacing.
+              if (Slot* old = std::exchange(ring[next & mask], &slot)) {
+                Unref(*old);
+              }
+            }
+            if (!Publish(value != nullptr, std::move(error),
+                         reads < read_ahead)) {
+              break;
+            }
           }
-          // This subscriber will fetch the value for the next round.
-          read_in_progress = true;
-          co_return kReadNewValue;
+          break;
+        }
+        case kWait: {
+          // We were suspended and then woken up by another subscriber making
+          // progress; re-evaluate.
+          break;
+        }
+        case kExhausted: {
+          if (exception) {
+            std::rethrow_exception(exception);
+          }
+          co_return;
         }
-        variant = std::move(subscriber.values.front());
-        subscriber.values.pop();
-      }
-      if (std::holds_alternative<Exhausted>(variant)) {
-        co_return kExhausted;
-      } else if (auto* exception = std::get_if<std::exception_ptr>(&variant)) {
-        std::rethrow_exception(*exception);
-      } else if (auto* value =
-                     std::get_if<std::shared_ptr<const T>>(&variant)) {
-        co_await subscriber.yielder->Yield(**value);
       }
     }
   }
 
-  // Read new value from publisher.
-  Task<std::shared_ptr<const T>> ReadFromPublisher() {
-    T* const value = co_await publisher;
-    if (value) {
-      co_return std::make_shared<const T>(std::move(*value));
+  // Determines what `subscriber` should do next. Must be called with `mutex`
+  // held.
+  Action Poll(Subscriber& subscriber) {
+    const std::uint64_t next = published.load(std::memory_order::relaxed);
+    std::uint64_t sequence = subscriber.cursor.load(std::memory_order::relaxed);
+    if (!subscriber.blocking) {
+      // Skip values that are too old, or that the in-progress read is about to
+      // overwrite.
+      std::uint64_t oldest = next - std::min(next, subscriber.max_lag);
+      if (read_in_progress && next + 1 > ring.size()) {
+        oldest = std::max(oldest, next + 1 - ring.size());
+      }
+      if (sequence < oldest) {
+        subscriber.RecordDrop(oldest - sequence);
+        sequence = oldest;
+        subscriber.cursor.store(sequence, std::memory_order::relaxed);
+      }
+      if (sequence < next) {
+        // Keep the value alive after the ring moves past it.
+        subscriber.held = ring[sequence & mask];
+        subscriber.held->refs.fetch_add(1, std::memory_order::relaxed);
+      }
+    }
+    if (sequence < next) {
+      subscriber.RecordConsume(next - sequence);
+      return kConsume;
     }
-    co_return nullptr;
+    if (end) {
+      return kExhausted;
+    }
+    if (read_in_progress || !HasSpace(next)) {
+      return kWait;
+    }
+    // This subscriber will fetch the value for the next round.
+    read_in_progress = true;
+    return kRead;
   }
 
-  // Notify all subscribers of new upstream value.
-  void PublishNewValue(std::shared_ptr<const T> value) {
-    // Coroutines that were waiting for the upstream value read to complete
-    // can now be awoken.
-    std::vector<std::coroutine_handle<>> waiting_for_value;
-    {
-      auto lock = std::lock_guard(mutex);
-      read_in_progress = false;
-      for (Subscriber& s : subscribers) {
-        s.values.push(value);
-        if (s.waiting) {
-          waiting_for_value.push_back(std::exchange(s.waiting, nullptr));
-        }
-      }
+  // Whether value `next` can be written without overwriting a value that some
+  // subscriber still needs. Must be called with `mutex` held.
+  bool HasSpace(std::uint64_t next) {
+    if (next < gate) {
+      return true;
     }
-    for (std::coroutine_handle<> handle : waiting_for_value) {
-      handle.resume();
+    // Announce that we're gated before re-reading the cursors. Paired with the
+    // cursor store and `gated` load in Release(), this ensures that either we
+    // observe the subscriber's progress here or it observes `gated` and wakes
+    // us up.
+    gated.store(true, std::memory_order::seq_cst);
+    UpdateGate();
+    if (next < gate) {
+      gated.store(false, std::memory_order::relaxed);
+      return true;
+    }
+    for (Subscriber& s : subscribers) {
+      if (s.Gate() <= next) {
+        s.RecordStall();
+      }
     }
+    return false;
   }
 
-  // Single iteration of a subscription. Returns true if the generator should
-  // continue afterwards, and false otherwise.
-  Task<bool> SubscriptionRound(Subscriber& subscriber) {
-    switch (co_await ConsumeAllCurrentValues(subscriber)) {
-      case kReadNewValue: {
-        // We're the designated reader for this round. Read a new value from
-        // upstream.
-        PublishNewValue(co_await ReadFromPublisher());
-        [[fallthrough]];
-      }
-      case kWaitForNewValue: {
-        co_await WaitForNewValue(subscriber);
-        co_return true;
-      }
-      case kExhausted: {
-        co_return false;
-      }
+  // Recomputes `gate` from the current position of each subscriber. Must be
+  // called with `mutex` held.
+  void UpdateGate() {
+    gate = Subscriber::kUngated;
+    for (const Subscriber& s : subscribers) {
+      gate = std::min(gate, s.Gate());
     }
   }
 
-  // Awaitable that waits for tje current in-progress read to finish.
-  auto WaitForNewValue(Subscriber& subscriber) {
-    struct Awaiter : std::suspend_always {
+  // Awaitable that resolves to the next action for `subscriber`. If that action
+  // is kWait, the subscriber is suspended until another subscriber makes
+  // progress.
+  auto NextAction(Subscriber& subscriber) {
+    struct Awaiter {
       State& state;
       Subscriber& subscriber;
+      Action action = kWait;
 
-      std::coroutine_handle<> await_suspend(std::coroutine_handle<> handle) {
+      // Fast path: a value is already available and the mutex is not needed.
+      // Non-blocking subscribers always need the mutex to safely pick which
+      // value to consume.
+      bool await_ready() {
+        if (!subscriber.blocking) {
+          return false;
+        }
+        const std::uint64_t sequence =
+            subscriber.cursor.load(std::memory_order::relaxed);
+        const std::uint64_t next =
+            state.published.load(std::memory_order::acquire);
+        if (sequence < next) {
+          subscriber.RecordConsume(next - sequence);
+          action = kConsume;
+          return true;
+        }
+        return false;
+      }
+
+      bool await_suspend(std::coroutine_handle<> handle) {
         auto lock = std::lock_guard(state.mutex);
-        subscriber.waiting = handle;
-        // Find a subscriber to wake up that has pending values. Note that this
-        // may also resume the current subscriber.
-        for (Subscriber& s : state.subscribers) {
-          if (!s.values.empty() && s.waiting) {
-            return std::exchange(s.waiting, nullptr);
-          }
+        action = state.Poll(subscriber);
+        if (action != kWait) {
+          return false;
         }
-        // No pending subscribers; we're waiting on some external actor to
-        // progress the system.
-        //
-        // TODO(dhrosa): Can this case actually be reached?
-        return std::noop_coroutine();
+        subscriber.suspended = handle;
+        state.waiting.push_back(&subscriber);
+        return true;
       }
-    };
 
+      Action await_resume() { return action; }
+    };
     return Awaiter{.state = *this, .subscriber = subscriber};
   }
+
+  // A suspended subscriber, and where it should be resumed.
+  struct Wakeup {
+    std::coroutine_handle<> handle;
+    Executor* executor;
+  };
+
+  // Removes all subscribers from `waiting`, returning their coroutines. Must be
+  // called with `mutex` held.
+  std::vector<Wakeup> TakeWaiting() {
+    std::vector<Wakeup> wakeups;
+    wakeups.reserve(waiting.size());
+    for (Subscriber* s : waiting) {
+      wakeups.push_back({.handle = std::exchange(s->suspended, nullptr),
+                         .executor = s->executor});
+    }
+    waiting.clear();
+    return wakeups;
+  }
+
+  static void ResumeAll(const std::vector<Wakeup>& wakeups) {
+    // Hand off to executors first, so that those subscribers don't have to
+    // wait for the ones we resume inline.
+    for (const Wakeup& wakeup : wakeups) {
+      if (wakeup.executor) {
+        wakeup.executor->Enqueue(wakeup.handle);
+      }
+    }
+    for (const Wakeup& wakeup : wakeups) {
+      if (!wakeup.executor) {
+        wakeup.handle.resume();
+      }
+    }
+  }
+
+  // Called by the designated reader once its read from `publisher` completes.
+  // `has_value` is false if the publisher was exhausted or threw `error`.
+  // Returns true if the reader should go on to read another value, which is
+  // the case if `read_more` is set and there's space for it.
+  bool Publish(bool has_value, std::exception_ptr error, bool read_more) {
+    std::vector<Wakeup> to_resume;
+    bool keep_reading = false;
+    {
+      auto lock = std::lock_guard(mutex);
+      const std::uint64_t next = published.load(std::memory_order::relaxed);
+      if (has_value) {
+        published.store(next + 1, std::memory_order::release);
+        if (read_more) {
+          if (next + 1 >= gate) {
+            UpdateGate();
+          }
+          keep_reading = next + 1 < gate;
+        }
+      } else {
+        end = next;
+        exception = std::move(error);
+      }
+      read_in_progress = keep_reading;
+      to_resume = TakeWaiting();
+    }
+    ResumeAll(to_resume);
+    return keep_reading;
+  }
+
+  // Returns a free slot with a single reference, for the ring. Only called by
+  // the current reader.
+  Slot& AcquireSlot() {
+    if (spare == nullptr) {
+      spare = released.exchange(nullptr, std::memory_order::acquire);
+    }
+    Slot* slot = spare;
+    if (slot) {
+      spare = slot->next_free;
+    } else {
+      slot = &pool.emplace_back();
+    }
+    slot->refs.store(1, std::memory_order::relaxed);
+    return *slot;
+  }
+
+  // Drops a reference to `slot`, returning it to the pool if it was the last.
+  void Unref(Slot& slot) {
+    if (slot.refs.fetch_sub(1, std::memory_order::acq_rel) != 1) {
+      return;
+    }
+    Slot* head = released.load(std::memory_order::relaxed);
+    do {
+      slot.next_free = head;
+    } while (!released.compare_exchange_weak(head, &slot,
+                                             std::memory_order::release,
+                                             std::memory_order::relaxed));
+  }
+
+  // Moves `subscriber` past the value it was holding.
+  void Release(Subscriber& subscriber, std::uint64_t next) {
+    subscriber.cursor.store(next, std::memory_order::seq_cst);
+    if (Slot* held = std::exchange(subscriber.held, nullptr)) {
+      Unref(*held);
+    }
+    if (!gated.load(std::memory_order::seq_cst)) {
+      return;
+    }
+    std::vector<Wakeup> to_resume;
+    {
+      auto lock = std::lock_guard(mutex);
+      gated.store(false, std::memory_order::relaxed);
+      to_resume = TakeWaiting();
+    }
+    ResumeAll(to_resume);
+  }
+
+  // The sequence number a new subscriber starts at. Must be called with `mutex`
+  // held.
+  std::uint64_t ReplayStart() const {
+    const std::uint64_t next = published.load(std::memory_order::relaxed);
+    // Because `replay_count` is less than the capacity, none of these values
+    // can be overwritten by an in-progress read.
+    std::uint64_t start = next - std::min(next, replay_count);
+    if (replay_age != absl::InfiniteDuration()) {
+      const absl::Time cutoff = absl::Now() - replay_age;
+      while (start < next && ring[start & mask]->published_at < cutoff) {
+        ++start;
+      }
+    }
+    return start;
+  }
+
+  typename std::list<Subscriber>::iterator Subscribe(SubscribeOptions options) {
+    auto lock = std::lock_guard(mutex);
+    auto it = subscribers.emplace(subscribers.end(), std::move(options),
+                                  ring.size(), ReplayStart());
+    gate = std::min(gate, it->Gate());
+    return it;
+  }
+
+  void Unsubscribe(typename std::list<Subscriber>::iterator it) {
+    std::vector<Wakeup> to_resume;
+    {
+      auto lock = std::lock_guard(mutex);
+      if (it->held) {
+        Unref(*it->held);
+      }
+      std::erase(waiting, &*it);
+      subscribers.erase(it);
+      // The removed subscriber may have been the one holding back the
+      // publisher.
+      if (gated.load(std::memory_order::relaxed)) {
+        gated.store(false, std::memory_order::relaxed);
+        to_resume = TakeWaiting();
+      }
+    }
+    ResumeAll(to_resume);
+  }
 };
 
+template <typename T>
+Broadcast<T>::Broadcast(AsyncGenerator<T>&& publisher, Options options)
+    : state_{.publisher = std::move(publisher),
+             .pool = std::deque<Slot>(std::bit_ceil(options.capacity) + 1),
+             .ring = std::vector<Slot*>(std::bit_ceil(options.capacity)),
+             .mask = std::bit_ceil(options.capacity) - 1,
+             .replay_count = std::min(options.replay_count,
+                                      std::bit_ceil(options.capacity) - 1),
+             .replay_age = options.replay_age,
+             .read_ahead = std::max<std::size_t>(options.read_ahead, 1)} {
+  assert(options.capacity > 0);
+  for (Slot& slot : state_.pool) {
+    slot.next_free = std::exchange(state_.spare, &slot);
+  }
+}
+
+template <typename T>
+Broadcast<T>::Broadcast(AsyncGenerator<T>&& publisher, std::size_t capacity)
+    : Broadcast(std::move(publisher), Options{.capacity = capacity}) {}
+
 template <typename T>
 AsyncGenerator<const T> Broadcast<T>::Subscribe() {
-  state_.subscribers.emplace_back();
-  return state_.Subscription(state_.subscribers.back());
+  return Subscribe(SubscribeOptions{});
+}
+
+template <typename T>
+AsyncGenerator<const T> Broadcast<T>::Subscribe(SubscribeOptions options) {
+  return state_.Subscription(
+      Registration(state_, state_.Subscribe(std::move(options))));
 }
@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "benchmark_util.h"
+#include "diy/coro/broadcast.h"
+#include "diy/coro/executor.h"
+
+constexpr int kBatchSize = 10'000;
+
+AsyncGenerator<int> Iota(int count) {
+  for (int i = 0; i < count; ++i) {
+    co_yield i;
+  }
+}
+
+// Cost per delivered value, with every subscriber pulled round-robin from the
+// benchmark thread.
+static void BM_BroadcastFanOut(benchmark::State& state) {
+  const int subscriber_count = state.range(0);
+  for (auto _ : state) {
+    Broadcast<int> broadcast(Iota(kBatchSize));
+    std::vector<AsyncGenerator<const int>> subscribers;
+    for (int i = 0; i < subscriber_count; ++i) {
+      subscribers.push_back(broadcast.Subscribe());
+    }
+    for (int i = 0; i < kBatchSize; ++i) {
+      for (AsyncGenerator<const int>& subscriber : subscribers) {
+        benchmark::DoNotOptimize(subscriber.Wait());
+      }
+    }
+  }
+  state.SetItemsProcessed(kBatchSize * subscriber_count * state.iterations());
+}
+
+// Same, but with each subscriber consuming on its own executor.
+static void BM_BroadcastFanOutThreaded(benchmark::State& state) {
+  auto consume = [](SerialExecutor& executor,
+                    AsyncGenerator<const int>& values,
+                    std::atomic_int& remaining) -> Detached {
+    co_await executor.Schedule();
+    while (true) {
+      const int* value = co_await values;
+      if (value == nullptr) {
+        break;
+      }
+      benchmark::DoNotOptimize(*value);
+    }
+    remaining.fetch_sub(1, std::memory_order::release);
+  };
+
+  const int subscriber_count = state.range(0);
+  std::deque<SerialExecutor> executors(subscriber_count);
+  for (auto _ : state) {
+    Broadcast<int> broadcast(Iota(kBatchSize), {.read_ahead = 16});
+    std::vector<AsyncGenerator<const int>> subscribers;
+    for (SerialExecutor& executor : executors) {
+      subscribers.push_back(broadcast.Subscribe({.executor = &executor}));
+    }
+    std::atomic_int remaining = subscriber_count;
+    for (int i = 0; i < subscriber_count; ++i) {
+      consume(executors[i], subscribers[i], remaining);
+    }
+    SpinUntil(
+        [&] { return remaining.load(std::memory_order::acquire) == 0; });
+  }
+  state.SetItemsProcessed(kBatchSize * subscriber_count * state.iterations());
+}
+
+BENCHMARK(BM_BroadcastFanOut)->Arg(1)->Arg(8)->Arg(64);
+BENCHMARK(BM_BroadcastFanOutThreaded)->Arg(1)->Arg(8)->Arg(64)->UseRealTime();
@@ -1,12 +1,16 @@
 #include "diy/coro/broadcast.h"
 
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <optional>
 #include <thread>
 
 #include "diy/coro/container_generator.h"
+#include "diy/coro/executor.h"
 #include "diy/coro/task.h"
 
 using testing::ElementsAre;
@@ -67,6 +71,21 @@ TEST(BroadcastTest, SingleSubscriberForwardsException) {
   EXPECT_THROW(s.Wait(), std::logic_error);
 }
 
+TEST(BroadcastTest, MultipleSubscribersForwardException) {
+  Broadcast<int> broadcast([]() -> AsyncGenerator<int> {
+    co_yield 1;
+    throw std::logic_error("fake error");
+  }());
+
+  auto a = broadcast.Subscribe();
+  auto b = broadcast.Subscribe();
+
+  EXPECT_THAT(a.Wait(), Pointee(1));
+  EXPECT_THAT(b.Wait(), Pointee(1));
+  EXPECT_THROW(a.Wait(), std::logic_error);
+  EXPECT_THROW(b.Wait(), std::logic_error);
+}
+
 TEST(BroadcastTest, SingleSubscriberFinite) {
   Broadcast<int> broadcast([]() -> AsyncGenerator<int> {
     co_yield 1;
@@ -114,3 +133,334 @@ TEST(BroadcastTest, Threaded) {
   thread_a.join();
   thread_b.join();
 }
+
+// Each value should be stored once and read in-place by every subscriber.
+TEST(BroadcastTest, SubscribersShareValues) {
+  Broadcast<int> broadcast(IotaPublisher());
+
+  auto a = broadcast.Subscribe();
+  auto b = broadcast.Subscribe();
+
+  const int* value_a = a.Wait();
+  const int* value_b = b.Wait();
+  EXPECT_THAT(value_a, Pointee(0));
+  EXPECT_EQ(value_a, value_b);
+}
+
+// The publisher should not get further ahead of the slowest subscriber than the
+// broadcast's capacity.
+TEST(BroadcastTest, SlowSubscriberGatesPublisher) {
+  std::atomic_int reads = 0;
+  Broadcast<int> broadcast(
+      [](std::atomic_int& reads) -> AsyncGenerator<int> {
+        for (int i = 0;; ++i) {
+          ++reads;
+          co_yield i;
+        }
+      }(reads),
+      /*capacity=*/4);
+
+  auto fast = broadcast.Subscribe();
+  auto slow = broadcast.Subscribe();
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_THAT(fast.Wait(), Pointee(i));
+  }
+  std::jthread fast_thread([&] { EXPECT_THAT(fast.Wait(), Pointee(4)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(reads, 4);
+
+  // Consuming the oldest value should free up space for `fast` to continue.
+  EXPECT_THAT(slow.Wait(), Pointee(0));
+  EXPECT_THAT(slow.Wait(), Pointee(1));
+  fast_thread.join();
+  EXPECT_EQ(reads, 5);
+}
+
+TEST(BroadcastTest, LateSubscriberStartsAtHead) {
+  Broadcast<int> broadcast(IotaPublisher());
+
+  auto a = broadcast.Subscribe();
+  EXPECT_THAT(a.Wait(), Pointee(0));
+  EXPECT_THAT(a.Wait(), Pointee(1));
+
+  auto b = broadcast.Subscribe();
+  EXPECT_THAT(b.Wait(), Pointee(2));
+  EXPECT_THAT(a.Wait(), Pointee(2));
+  EXPECT_THAT(a.Wait(), Pointee(3));
+  EXPECT_THAT(b.Wait(), Pointee(3));
+}
+
+TEST(BroadcastTest, DestroyedSubscriberNoLongerGatesPublisher) {
+  Broadcast<int> broadcast(IotaPublisher(), /*capacity=*/2);
+
+  auto a = broadcast.Subscribe();
+  {
+    auto b = broadcast.Subscribe();
+    EXPECT_THAT(b.Wait(), Pointee(0));
+    // Never started.
+    auto c = broadcast.Subscribe();
+  }
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(a.Wait(), Pointee(i));
+  }
+}
+
+TEST(BroadcastTest, DestroyingSlowSubscriberUnblocksPublisher) {
+  Broadcast<int> broadcast(IotaPublisher(), /*capacity=*/2);
+
+  auto fast = broadcast.Subscribe();
+  std::optional<AsyncGenerator<const int>> slow = broadcast.Subscribe();
+
+  EXPECT_THAT(fast.Wait(), Pointee(0));
+  EXPECT_THAT(fast.Wait(), Pointee(1));
+  std::jthread fast_thread([&] { EXPECT_THAT(fast.Wait(), Pointee(2)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  slow.reset();
+  fast_thread.join();
+}
+
+TEST(BroadcastTest, DropOldestSkipsValues) {
+  using B = Broadcast<int>;
+  B broadcast(IotaPublisher(), /*capacity=*/8);
+
+  auto counters = std::make_shared<B::SubscriberCounters>();
+  auto fast = broadcast.Subscribe();
+  auto dropping = broadcast.Subscribe(
+      {.policy = B::SlowSubscriberPolicy::kDropOldest,
+       .max_lag = 2,
+       .counters = counters});
+
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_THAT(fast.Wait(), Pointee(i));
+  }
+  EXPECT_THAT(dropping.Wait(), Pointee(4));
+  EXPECT_THAT(dropping.Wait(), Pointee(5));
+  EXPECT_EQ(counters->consumed, 2);
+  EXPECT_EQ(counters->dropped, 4);
+  EXPECT_EQ(counters->gaps, 1);
+  EXPECT_EQ(counters->max_lag, 2);
+}
+
+TEST(BroadcastTest, ConflateYieldsLatestValue) {
+  using B = Broadcast<int>;
+  B broadcast(IotaPublisher(), /*capacity=*/8);
+
+  auto counters = std::make_shared<B::SubscriberCounters>();
+  auto fast = broadcast.Subscribe();
+  auto conflating = broadcast.Subscribe(
+      {.policy = B::SlowSubscriberPolicy::kConflate, .counters = counters});
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_THAT(fast.Wait(), Pointee(i));
+  }
+  EXPECT_THAT(conflating.Wait(), Pointee(4));
+  EXPECT_EQ(counters->dropped, 4);
+
+  // Caught up; the next value is read from the publisher.
+  EXPECT_THAT(conflating.Wait(), Pointee(5));
+  EXPECT_EQ(counters->dropped, 4);
+}
+
+TEST(BroadcastTest, NonBlockingSubscriberDoesNotGatePublisher) {
+  using B = Broadcast<int>;
+  B broadcast(IotaPublisher(), /*capacity=*/4);
+
+  auto fast = broadcast.Subscribe();
+  auto conflating =
+      broadcast.Subscribe({.policy = B::SlowSubscriberPolicy::kConflate});
+  auto idle =
+      broadcast.Subscribe({.policy = B::SlowSubscriberPolicy::kDropOldest});
+
+  // The held value stays intact while the publisher laps the ring.
+  const int* held = conflating.Wait();
+  EXPECT_THAT(held, Pointee(0));
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_THAT(fast.Wait(), Pointee(i));
+  }
+  EXPECT_THAT(held, Pointee(0));
+  EXPECT_THAT(conflating.Wait(), Pointee(19));
+}
+
+TEST(BroadcastTest, BlockingSubscriberMaxLag) {
+  using B = Broadcast<int>;
+  B broadcast(IotaPublisher(), /*capacity=*/8);
+
+  auto counters = std::make_shared<B::SubscriberCounters>();
+  auto fast = broadcast.Subscribe();
+  auto slow = broadcast.Subscribe({.max_lag = 2, .counters = counters});
+
+  EXPECT_THAT(fast.Wait(), Pointee(0));
+  EXPECT_THAT(fast.Wait(), Pointee(1));
+  std::jthread fast_thread([&] { EXPECT_THAT(fast.Wait(), Pointee(2)); });
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (counters->publisher_stalls == 0 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(counters->publisher_stalls, 1);
+
+  EXPECT_THAT(slow.Wait(), Pointee(0));
+  EXPECT_EQ(counters->lag, 2);
+  EXPECT_THAT(slow.Wait(), Pointee(1));
+  fast_thread.join();
+}
+
+TEST(BroadcastTest, ReplaysRecentValuesToLateSubscriber) {
+  Broadcast<int> broadcast(IotaPublisher(),
+                           {.capacity = 8, .replay_count = 3});
+
+  auto a = broadcast.Subscribe();
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_THAT(a.Wait(), Pointee(i));
+  }
+  const int* a_last = a.Wait();
+
+  auto b = broadcast.Subscribe();
+  EXPECT_THAT(b.Wait(), Pointee(2));
+  EXPECT_THAT(b.Wait(), Pointee(3));
+  // Replayed values are shared with the live subscribers.
+  const int* replayed = b.Wait();
+  EXPECT_THAT(replayed, Pointee(4));
+  EXPECT_EQ(replayed, a_last);
+  EXPECT_THAT(b.Wait(), Pointee(5));
+}
+
+TEST(BroadcastTest, ReplayAfterPublisherFinished) {
+  Broadcast<int> broadcast(
+      []() -> AsyncGenerator<int> {
+        co_yield 1;
+        co_yield 2;
+        co_yield 3;
+      }(),
+      {.replay_count = 2});
+
+  auto a = broadcast.Subscribe();
+  EXPECT_THAT(a.ToVector(), ElementsAre(1, 2, 3));
+
+  auto b = broadcast.Subscribe();
+  EXPECT_THAT(b.ToVector(), ElementsAre(2, 3));
+}
+
+TEST(BroadcastTest, ReplaySkipsExpiredValues) {
+  Broadcast<int> broadcast(IotaPublisher(),
+                           {.capacity = 8,
+                            .replay_count = 8,
+                            .replay_age = absl::Milliseconds(500)});
+
+  auto a = broadcast.Subscribe();
+  EXPECT_THAT(a.Wait(), Pointee(0));
+  EXPECT_THAT(a.Wait(), Pointee(1));
+  absl::SleepFor(absl::Seconds(1));
+  EXPECT_THAT(a.Wait(), Pointee(2));
+
+  auto b = broadcast.Subscribe();
+  EXPECT_THAT(b.Wait(), Pointee(2));
+  EXPECT_THAT(b.Wait(), Pointee(3));
+}
+
+TEST(BroadcastTest, ReadAheadFillsWindow) {
+  std::atomic_int reads = 0;
+  Broadcast<int> broadcast(
+      [](std::atomic_int& reads) -> AsyncGenerator<int> {
+        for (int i = 0;; ++i) {
+          ++reads;
+          co_yield i;
+        }
+      }(reads),
+      {.capacity = 8, .read_ahead = 4});
+
+  auto s = broadcast.Subscribe();
+  EXPECT_THAT(s.Wait(), Pointee(0));
+  EXPECT_EQ(reads, 4);
+  EXPECT_THAT(s.Wait(), Pointee(1));
+  EXPECT_THAT(s.Wait(), Pointee(2));
+  EXPECT_THAT(s.Wait(), Pointee(3));
+  EXPECT_EQ(reads, 4);
+  EXPECT_THAT(s.Wait(), Pointee(4));
+  EXPECT_EQ(reads, 8);
+}
+
+TEST(BroadcastTest, SubscribersRunOnExecutors) {
+  using B = Broadcast<int>;
+  constexpr int kCount = 1000;
+  B broadcast(
+      []() -> AsyncGenerator<int> {
+        for (int i = 0; i < kCount; ++i) {
+          co_yield i;
+        }
+      }(),
+      {.capacity = 16, .read_ahead = 8});
+
+  SerialExecutor executor_a;
+  SerialExecutor executor_b;
+  struct Result {
+    int sum = 0;
+    bool on_executor = true;
+  };
+  auto consume = [](SerialExecutor& executor,
+                    AsyncGenerator<const int>& values) -> Task<Result> {
+    co_await executor.Schedule();
+    Result result;
+    while (true) {
+      const int* value = co_await values;
+      if (value == nullptr) {
+        break;
+      }
+      result.sum += *value;
+      result.on_executor = result.on_executor && executor.IsCurrent();
+    }
+    co_return result;
+  };
+  // Owned by the test rather than the consumer tasks, so that they're not
+  // destroyed on the executor threads after Wait() returns.
+  auto values_a = broadcast.Subscribe({.executor = &executor_a});
+  auto values_b = broadcast.Subscribe({.executor = &executor_b});
+  Task<Result> a = consume(executor_a, values_a);
+  Task<Result> b = consume(executor_b, values_b);
+
+  std::jthread thread_a([&] {
+    const Result result = std::move(a).Wait();
+    EXPECT_EQ(result.sum, kCount * (kCount - 1) / 2);
+    EXPECT_TRUE(result.on_executor);
+  });
+  const Result result = std::move(b).Wait();
+  EXPECT_EQ(result.sum, kCount * (kCount - 1) / 2);
+  EXPECT_TRUE(result.on_executor);
+}
+
+// Counts move constructions, but not move assignments.
+struct Counted {
+  static inline std::atomic_int constructions = 0;
+
+  int value;
+
+  explicit Counted(int value) : value(value) {}
+  Counted(Counted&& other) : value(other.value) { ++constructions; }
+  Counted& operator=(Counted&&) = default;
+};
+
+// Values are moved into recycled slots rather than constructed afresh.
+TEST(BroadcastTest, ReusesSlots) {
+  Counted::constructions = 0;
+  Broadcast<Counted> broadcast(
+      []() -> AsyncGenerator<Counted> {
+        for (int i = 0;; ++i) {
+          co_yield Counted(i);
+        }
+      }(),
+      /*capacity=*/4);
+
+  auto a = broadcast.Subscribe();
+  auto b = broadcast.Subscribe(
+      {.policy = Broadcast<Counted>::SlowSubscriberPolicy::kConflate});
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(a.Wait()->value, i);
+    if (i % 3 == 0) {
+      EXPECT_EQ(b.Wait()->value, i);
+    }
+  }
+  // One per slot in the pool; the ring plus one spare.
+  EXPECT_EQ(Counted::constructions, 5);
+}
@@ -2,25 +2,86 @@
 
 #include <concepts>
 #include <coroutine>
-#include <stdexcept>
+#include <cstddef>
+#include <exception>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "diy/coro/frame_allocator.h"
 #include "diy/coro/handle.h"
+#include "diy/coro/trace.h"
 
-// Coroutine for generating a vector of elements. Each 'co_yield' within the
-// coroutine body appends to the eventual output.
-template <typename T>
-class VectorGenerator {
+// Yielded from a ContainerGenerator to reserve room for `size` more elements,
+// if the container supports reserve().
+struct SizeHint {
+  std::size_t size;
+};
+
+// Yielded from a ContainerGenerator to construct an element in-place from
+// `args`.
+template <typename... Args>
+struct Emplace {
+  explicit Emplace(Args&&... args) : args(std::forward<Args>(args)...) {}
+
+  std::tuple<Args&&...> args;
+};
+
+template <typename... Args>
+Emplace(Args&&...) -> Emplace<Args...>;
+
+// Coroutine argument naming the container that a ContainerGenerator<C&>
+// appends to. Refers to the container, so that it may be taken by value.
+template <typename C>
+struct OutputTo {
+  C& container;
+};
+
+template <typename C>
+OutputTo(C&) -> OutputTo<C>;
+
+// Whether ContainerGenerator can insert an element constructed from `args`
+// into a `C`.
+template <typename C, typename... Args>
+concept ContainerInsertable = requires(C& c, Args&&... args) {
+  requires requires { c.emplace_back(std::forward<Args>(args)...); } ||
+               requires { c.push_back(std::forward<Args>(args)...); } ||
+               requires { c.append(std::forward<Args>(args)...); } ||
+               requires { c.emplace(std::forward<Args>(args)...); };
+};
+
+// Coroutine for generating a container of elements. Each 'co_yield' within the
+// coroutine body inserts into the eventual output, using the first of
+// emplace_back(), push_back(), append() or emplace() that the container
+// supports; so `Container` may be a sequence, a string, or a set.
+//
+//   ContainerGenerator<absl::flat_hash_set<int>> Squares(int n) {
+//     co_yield SizeHint(n);
+//     for (int i = 0; i < n; ++i) {
+//       co_yield i * i;
+//     }
+//   }
+//
+// If `Container` is an lvalue reference, the output is instead appended to the
+// container passed in the coroutine's first OutputTo argument, such as a buffer
+// reused across calls, and a reference to it is returned:
+//
+//   ContainerGenerator<std::string&> AppendDigits(OutputTo<std::string> out,
+//                                                 int n);
+//   std::string& digits = AppendDigits(OutputTo(buffer), 3);
+template <typename Container>
+class ContainerGenerator {
   struct Promise;
 
  public:
   using promise_type = Promise;
 
   // Consume the coroutine output.
-  operator std::vector<T>() &&;
+  operator Container() &&;
 
  private:
-  VectorGenerator(Handle handle) : handle_(std::move(handle)) {}
+  ContainerGenerator(Handle handle) : handle_(std::move(handle)) {}
 
   Promise& promise() { return handle_.template promise<Promise>(); }
 
@@ -28,38 +89,116 @@ class VectorGenerator {
 };
 
 template <typename T>
-struct VectorGenerator<T>::Promise {
-  std::vector<T> values;
+using VectorGenerator = ContainerGenerator<std::vector<T>>;
+
+////////////////////
+// Implementation //
+////////////////////
+
+template <typename Container>
+struct ContainerGenerator<Container>::Promise
+    : frame_allocator::AllocatedFrame<Promise> {
+  using Sink = std::remove_reference_t<Container>;
+
+  Container values;
   std::exception_ptr exception;
 
+  [[no_unique_address]] trace::FrameTracer tracer{"ContainerGenerator"};
+
+  Promise()
+    requires(!std::is_reference_v<Container>)
+  = default;
+
+  template <typename... Args>
+  Promise(Args&... args)
+    requires(std::is_reference_v<Container> &&
+             (std::is_same_v<std::remove_cv_t<Args>, OutputTo<Sink>> || ...))
+      : values(FindSink(args...)) {}
+
   auto get_return_object() {
-    return VectorGenerator<T>(
+    return ContainerGenerator<Container>(
         Handle(std::coroutine_handle<Promise>::from_promise(*this)));
   }
 
   auto initial_suspend() { return std::suspend_never{}; }
 
-  template <std::convertible_to<T> U>
+  template <typename U>
+    requires ContainerInsertable<Sink, U>
   auto yield_value(U&& value) {
-    values.push_back(std::forward<U>(value));
+    Insert(std::forward<U>(value));
+    return std::suspend_never{};
+  }
+
+  auto yield_value(SizeHint hint) {
+    if constexpr (requires { values.reserve(hint.size); }) {
+      values.reserve(values.size() + hint.size);
+    }
+    return std::suspend_never{};
+  }
+
+  template <typename... Args>
+  auto yield_value(Emplace<Args...> emplace) {
+    std::apply(
+        [this](Args&&... args) { Insert(std::forward<Args>(args)...); },
+        std::move(emplace.args));
     return std::suspend_never{};
   }
 
   void unhandled_exception() { exception = std::current_exception(); }
 
-  auto final_suspend() noexcept { return std::suspend_always{}; }
+  auto final_suspend() noexcept {
+    tracer.Complete();
+    return std::suspend_always{};
+  }
+
+  void return_void() {}
 
   // Disallow co_await within the coroutine body; generators must be
   // synchronous.
   template <typename A>
   auto await_transform(A&&) = delete;
+
+  template <typename... Args>
+  void Insert(Args&&... args) {
+    if constexpr (requires {
+                    values.emplace_back(std::forward<Args>(args)...);
+                  }) {
+      values.emplace_back(std::forward<Args>(args)...);
+    } else if constexpr (requires {
+                           values.push_back(std::forward<Args>(args)...);
+                         }) {
+      values.push_back(std::forward<Args>(args)...);
+    } else if constexpr (requires {
+                           values.append(std::forward<Args>(args)...);
+                         }) {
+      values.append(std::forward<Args>(args)...);
+    } else {
+      values.emplace(std::forward<Args>(args)...);
+    }
+  }
+
+  // The arguments are the frame's copies of the coroutine's parameters, so
+  // the sink can't be a parameter of the container type itself: if taken by
+  // value, it would be a copy that dies with the frame.
+  template <typename First, typename... Rest>
+  static Sink& FindSink(First& first, Rest&... rest) {
+    if constexpr (std::is_same_v<std::remove_cv_t<First>, OutputTo<Sink>>) {
+      return first.container;
+    } else {
+      return FindSink(rest...);
+    }
+  }
 };
 
-template <typename T>
-VectorGenerator<T>::operator std::vector<T>() && {
+template <typename Container>
+ContainerGenerator<Container>::operator Container() && {
   Promise& p = promise();
   if (p.exception) {
     std::rethrow_exception(p.exception);
   }
-  return std::move(p.values);
+  if constexpr (std::is_reference_v<Container>) {
+    return p.values;
+  } else {
+    return std::move(p.values);
+  }
 }
@@ -11,6 +11,15 @@ std::vector<int> VectorRoutine(int n) {
   return values;
 }
 
+std::vector<int> ReservedVectorRoutine(int n) {
+  std::vector<int> values;
+  values.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    values.push_back(i);
+  }
+  return values;
+}
+
 std::vector<int> VectorCoroutine(int n) {
   return [n]() -> VectorGenerator<int> {
     for (int i = 0; i < n; ++i) {
@@ -19,6 +28,15 @@ std::vector<int> VectorCoroutine(int n) {
   }();
 }
 
+std::vector<int> ReservedVectorCoroutine(int n) {
+  return [n]() -> VectorGenerator<int> {
+    co_yield SizeHint(n);
+    for (int i = 0; i < n; ++i) {
+      co_yield i;
+    }
+  }();
+}
+
 constexpr int kVectorSize = 1'000;
 }  // namespace
 
@@ -36,5 +54,21 @@ static void BM_VectorCoroutine(benchmark::State& state) {
   state.SetItemsProcessed(kVectorSize * state.iterations());
 }
 
+static void BM_ReservedVectorRoutine(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ReservedVectorRoutine(kVectorSize));
+  }
+  state.SetItemsProcessed(kVectorSize * state.iterations());
+}
+
+static void BM_ReservedVectorCoroutine(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ReservedVectorCoroutine(kVectorSize));
+  }
+  state.SetItemsProcessed(kVectorSize * state.iterations());
+}
+
 BENCHMARK(BM_VectorRoutine);
 BENCHMARK(BM_VectorCoroutine);
+BENCHMARK(BM_ReservedVectorRoutine);
+BENCHMARK(BM_ReservedVectorCoroutine);
@@ -1,9 +1,19 @@
 #include "diy/coro/container_generator.h"
 
+#include <absl/container/flat_hash_set.h>
+#include <absl/container/inlined_vector.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 using testing::ElementsAre;
+using testing::Pair;
+using testing::UnorderedElementsAre;
 
 TEST(VectorGeneratorTest, PropagatesException) {
   auto gen = []() -> VectorGenerator<int> {
@@ -22,3 +32,83 @@ TEST(VectorGeneratorTest, PropagatesValues) {
 
   EXPECT_THAT(values, ElementsAre(1, 2, 3));
 }
+
+TEST(ContainerGeneratorTest, String) {
+  const std::string value = []() -> ContainerGenerator<std::string> {
+    co_yield 'a';
+    co_yield std::string_view("bc");
+    co_yield "de";
+  }();
+
+  EXPECT_EQ(value, "abcde");
+}
+
+TEST(ContainerGeneratorTest, HashSet) {
+  const absl::flat_hash_set<int> values =
+      [](int n) -> ContainerGenerator<absl::flat_hash_set<int>> {
+    co_yield SizeHint(n);
+    for (int i = 0; i < n; ++i) {
+      co_yield i % 2;
+    }
+  }(10);
+
+  EXPECT_THAT(values, UnorderedElementsAre(0, 1));
+}
+
+TEST(ContainerGeneratorTest, SizeHintReserves) {
+  const std::vector<int> values = []() -> VectorGenerator<int> {
+    co_yield SizeHint(100);
+    co_yield 1;
+  }();
+
+  EXPECT_THAT(values, ElementsAre(1));
+  EXPECT_GE(values.capacity(), 100);
+}
+
+TEST(ContainerGeneratorTest, Emplace) {
+  using Pairs = absl::InlinedVector<std::pair<int, std::string>, 2>;
+  const Pairs values = []() -> ContainerGenerator<Pairs> {
+    co_yield Emplace(1, "one");
+    const std::string two = "two";
+    co_yield Emplace(2, two);
+  }();
+
+  EXPECT_THAT(values, ElementsAre(Pair(1, "one"), Pair(2, "two")));
+}
+
+TEST(ContainerGeneratorTest, CallerProvidedContainer) {
+  // Taken by value; the frame's copy still refers to the caller's buffer.
+  auto append_digits = [](OutputTo<std::string> out,
+                          int n) -> ContainerGenerator<std::string&> {
+    for (int i = 0; i < n; ++i) {
+      co_yield static_cast<char>('0' + i);
+    }
+  };
+
+  std::string buffer = "digits: ";
+  std::string& result = append_digits(OutputTo(buffer), 3);
+  EXPECT_EQ(&result, &buffer);
+  EXPECT_EQ(buffer, "digits: 012");
+}
+
+// A parameter of the container type itself, even by reference, doesn't name
+// the output: if taken by value it would be the frame's own copy.
+static_assert(!std::is_constructible_v<
+              ContainerGenerator<std::string&>::promise_type, std::string&>);
+static_assert(std::is_constructible_v<
+              ContainerGenerator<std::string&>::promise_type,
+              OutputTo<std::string>&>);
+
+TEST(ContainerGeneratorTest, CallerProvidedContainerByReference) {
+  auto append_digits = [](int n, const OutputTo<std::string>& out)
+      -> ContainerGenerator<std::string&> {
+    for (int i = 0; i < n; ++i) {
+      co_yield static_cast<char>('0' + i);
+    }
+  };
+
+  std::string buffer;
+  std::string& result = append_digits(2, OutputTo(buffer));
+  EXPECT_EQ(&result, &buffer);
+  EXPECT_EQ(buffer, "01");
+}
@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+
+#include "benchmark_util.h"
+#include "diy/coro/event.h"
+#include "diy/coro/executor.h"
+
+using Clock = LatencyRecorder::Clock;
+
+// Time from Notify() to the waiter resuming, when the waiter is already
+// suspended and Notify() resumes it inline.
+static void BM_EventNotifyToResume(benchmark::State& state) {
+  auto wait = [](Event& event, const Clock::time_point& notified,
+                 LatencyRecorder& latencies) -> Detached {
+    co_await event;
+    latencies.Record(Clock::now() - notified);
+  };
+
+  LatencyRecorder latencies(1 << 20);
+  for (auto _ : state) {
+    Event event;
+    Clock::time_point notified;
+    wait(event, notified, latencies);
+    notified = Clock::now();
+    event.Notify();
+  }
+  latencies.Report(state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Time from Notify() on the benchmark thread to the waiter running again on its
+// own executor.
+static void BM_EventNotifyToResumeOnExecutor(benchmark::State& state) {
+  auto wait = [](SerialExecutor& executor, Event& event,
+                 const Clock::time_point& notified, LatencyRecorder& latencies,
+                 std::atomic_bool& done) -> Detached {
+    co_await executor.Schedule();
+    co_await event;
+    co_await executor.Schedule();
+    latencies.Record(Clock::now() - notified);
+    done.store(true, std::memory_order::release);
+  };
+
+  SerialExecutor executor;
+  LatencyRecorder latencies(1 << 20);
+  std::atomic_bool done;
+  for (auto _ : state) {
+    Event event;
+    Clock::time_point notified;
+    done.store(false, std::memory_order::relaxed);
+    wait(executor, event, notified, latencies, done);
+    notified = Clock::now();
+    event.Notify();
+    SpinUntil([&] { return done.load(std::memory_order::acquire); });
+  }
+  latencies.Report(state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_EventNotifyToResume);
+BENCHMARK(BM_EventNotifyToResumeOnExecutor)->UseRealTime();
@@ -1,67 +1,175 @@
 #include "diy/coro/executor.h"
 
+#include <pthread.h>
+#include <sched.h>
+
 #include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
 
-namespace {
-enum : int {
-  // No pending waiter.
-  kIdle,
-  kPending,
-  kStopRequested,
-};
-}  // namespace
+#include "diy/coro/executor_internal.h"
+#include "diy/coro/numa.h"
+
+using executor_internal::Add;
+using executor_internal::NowNanos;
 
 struct SerialExecutor::SharedState {
-  std::atomic_int state;
-  std::coroutine_handle<> pending;
+  struct Pending {
+    std::coroutine_handle<> handle;
+    // NowNanos() at the time of Enqueue().
+    std::int64_t enqueued_at;
+  };
+
+  executor_internal::WorkSignal signal;
+
+  // Synchronizes access to `pending` and `enqueued`.
+  std::mutex mutex;
+  // Coroutines waiting to be resumed, in scheduling order.
+  std::vector<Pending> pending;
+  std::uint64_t enqueued = 0;
+
+  // Metrics only written by the runner thread.
+  std::atomic_uint64_t resumed = 0;
+  std::atomic_uint64_t parks = 0;
+  std::atomic_int64_t parked_ns = 0;
+  Histogram schedule_delay_ns;
+  Histogram slice_ns;
+  Histogram queue_depth;
+
+  const Options options;
+  const cpu_set_t affinity;
+
+  // The executor, for Executor::Current(), until it is destroyed. The thread
+  // may outlive it.
+  std::atomic<Executor*> executor;
 
-  SharedState() { state.store(kIdle, std::memory_order::relaxed); }
+  SharedState(Options options, Executor* executor)
+      : options(options),
+        affinity(options.cpus.empty() ? cpu_set_t()
+                                      : numa::ToCpuSet(options.cpus)),
+        executor(executor) {}
 
-  void AwaitSuspend(std::coroutine_handle<> handle) {
-    pending = handle;
-    int previous_state = state.load(std::memory_order::acquire);
-    if (previous_state == kStopRequested) {
-      return;
+  // Budget for a slice starting at `now`.
+  SliceBudget NewSlice(std::int64_t now) const {
+    SliceBudget budget;
+    if (options.max_slice_awaits > 0) {
+      budget.awaits = options.max_slice_awaits;
     }
-    assert(previous_state == kIdle);
-    // Attempt kIdle -> kPending transition.
-    if (state.compare_exchange_strong(previous_state, kPending,
-                                      std::memory_order::acq_rel)) {
-      state.notify_one();
-      return;
+    if (options.max_slice_time > absl::ZeroDuration()) {
+      budget.deadline = now + absl::ToInt64Nanoseconds(options.max_slice_time);
     }
-    // Raced with a stop request.
-    assert(previous_state == kStopRequested);
+    return budget;
+  }
+
+  void Enqueue(std::coroutine_handle<> handle) {
+    const std::int64_t now = NowNanos();
+    {
+      auto lock = std::lock_guard(mutex);
+      pending.push_back({.handle = handle, .enqueued_at = now});
+      ++enqueued;
+    }
+    signal.Notify();
+  }
+
+  // Spins until there's new work, or the idle policy says to park instead.
+  // Returns false if the runner should park.
+  bool SpinForWork() {
+    if (!options.busy_poll && options.idle_spin_time <= absl::ZeroDuration()) {
+      return false;
+    }
+    return signal.Spin(
+        options.busy_poll
+            ? std::numeric_limits<std::int64_t>::max()
+            : NowNanos() + absl::ToInt64Nanoseconds(options.idle_spin_time));
   }
 
   void Run(std::stop_token stop_token) {
-    const auto on_stop = std::stop_callback(stop_token, [this] {
-      state.store(kStopRequested, std::memory_order::release);
-      state.notify_one();
-    });
+    if (!options.cpus.empty()) {
+      // Can't fail, as the CPUs were checked on construction.
+      ::pthread_setaffinity_np(::pthread_self(), sizeof(affinity), &affinity);
+    }
+    const auto on_stop =
+        std::stop_callback(stop_token, [this] { signal.Stop(); });
+    // Swapped with `pending` so that both vectors' storage is reused across
+    // batches. Both are allocated here, now that we're on our own CPUs.
+    constexpr std::size_t kInitialCapacity = 256;
+    std::vector<Pending> batch;
+    batch.reserve(kInitialCapacity);
+    {
+      auto lock = std::lock_guard(mutex);
+      pending.reserve(kInitialCapacity);
+    }
     while (true) {
-      // Wait for kIdle -> ?? transition.
-      state.wait(kIdle, std::memory_order::relaxed);
-      int previous_state = state.load(std::memory_order::acquire);
-      if (previous_state == kStopRequested) {
+      if (signal.idle() && !SpinForWork()) {
+        Add(parks, 1);
+        const std::int64_t parked_at = NowNanos();
+        signal.Park();
+        Add(parked_ns, NowNanos() - parked_at);
+      }
+      if (!signal.Consume()) {
         return;
       }
-      assert(previous_state == kPending);
-      // Attempt kPending -> kIdle transition.
-      if (state.compare_exchange_strong(previous_state, kIdle,
-                                        std::memory_order::acq_rel)) {
-        std::exchange(pending, nullptr).resume();
-        continue;
+      {
+        auto lock = std::lock_guard(mutex);
+        batch.swap(pending);
+      }
+      queue_depth.Record(batch.size());
+      // The end of each slice is the start of the next one.
+      std::int64_t now = NowNanos();
+      for (const Pending& p : batch) {
+        schedule_delay_ns.Record(now - p.enqueued_at);
+        current_ = executor.load(std::memory_order::acquire);
+        slice_budget_ = current_ != nullptr ? NewSlice(now) : SliceBudget();
+        p.handle.resume();
+        const std::int64_t start = std::exchange(now, NowNanos());
+        slice_ns.Record(now - start);
       }
-      // Racing stop request.
-      assert(previous_state == kStopRequested);
-      return;
+      Add(resumed, batch.size());
+      batch.clear();
+    }
+  }
+
+  ExecutorMetrics Metrics() {
+    ExecutorMetrics metrics;
+    {
+      auto lock = std::lock_guard(mutex);
+      metrics.enqueued = enqueued;
     }
+    metrics.resumed = resumed.load(std::memory_order::relaxed);
+    metrics.parks = parks.load(std::memory_order::relaxed);
+    metrics.parked_time =
+        absl::Nanoseconds(parked_ns.load(std::memory_order::relaxed));
+    metrics.schedule_delay_ns = schedule_delay_ns.TakeSnapshot();
+    metrics.slice_ns = slice_ns.TakeSnapshot();
+    metrics.queue_depth = queue_depth.TakeSnapshot();
+    return metrics;
   }
 };
 
-SerialExecutor::SerialExecutor()
-    : state_(new SharedState),
+Task<> Executor::Sleep(absl::Time time) {
+  co_await Schedule();
+  absl::SleepFor(time - absl::Now());
+}
+
+namespace task_internal {
+
+Executor* CurrentExecutor() { return Executor::Current(); }
+
+std::coroutine_handle<> TransferTo(Executor& executor,
+                                   std::coroutine_handle<> handle) {
+  if (executor.IsCurrent()) {
+    return handle;
+  }
+  executor.Enqueue(handle);
+  return std::noop_coroutine();
+}
+
+}  // namespace task_internal
+
+SerialExecutor::SerialExecutor(Options options)
+    : state_(new SharedState(options, this)),
       thread_(
           [](std::stop_token stop_token, std::shared_ptr<SharedState> state) {
             state->Run(stop_token);
@@ -69,6 +177,12 @@ SerialExecutor::SerialExecutor()
           state_) {}
 
 SerialExecutor::~SerialExecutor() {
+  state_->executor.store(nullptr, std::memory_order::release);
+  if (IsCurrent()) {
+    // Destroyed by one of our own coroutines, which carries on without us.
+    current_ = nullptr;
+    slice_budget_ = SliceBudget();
+  }
   // Let the scheduling thread finish up asynchronously. This allows
   // SerialExecutor instances to be constructed in a coroutine frame without
   // causing a deadlock when attempting to join the thread.
@@ -76,15 +190,17 @@ SerialExecutor::~SerialExecutor() {
   thread_.detach();
 }
 
-bool SerialExecutor::AwaitReady() const {
+bool SerialExecutor::IsCurrent() const {
   // If we're already running on this thread, then we don't need to actually
   // do anything.
   return std::this_thread::get_id() == thread_.get_id();
 }
 
-void SerialExecutor::AwaitSuspend(std::coroutine_handle<> pending) {
+void SerialExecutor::Enqueue(std::coroutine_handle<> handle) {
   // This await might unblock some event that causes us to be destructed. So the
   // destruction may race with our access to state_.
   std::shared_ptr<SharedState> state = state_;
-  state->AwaitSuspend(pending);
+  state->Enqueue(handle);
 }
+
+ExecutorMetrics SerialExecutor::Metrics() const { return state_->Metrics(); }
@@ -1,48 +1,163 @@
 #pragma once
 
 #include <absl/synchronization/mutex.h>
+#include <absl/time/clock.h>
 #include <absl/time/time.h>
 
+#include <chrono>
 #include <coroutine>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <stop_token>
 #include <thread>
 #include <vector>
 
+#include "diy/coro/histogram.h"
 #include "diy/coro/task.h"
 
-// Allows transferring a coroutine to a different thread than the caller.
-class SerialExecutor {
+// Cumulative load statistics of an executor since it was constructed. Subtract
+// an earlier snapshot's histograms to get statistics for an interval.
+struct ExecutorMetrics {
+  // Number of coroutines handed to the executor, and resumed by it.
+  std::uint64_t enqueued = 0;
+  std::uint64_t resumed = 0;
+  // Number of times the executor ran out of work and parked its thread, and
+  // the total time spent parked, excluding any park still in progress.
+  std::uint64_t parks = 0;
+  absl::Duration parked_time;
+  // Nanoseconds from Enqueue() until the coroutine was resumed.
+  Histogram::Snapshot schedule_delay_ns;
+  // Nanoseconds each resumed coroutine ran before control returned to the
+  // executor.
+  Histogram::Snapshot slice_ns;
+  // Number of coroutines waiting each time the executor picked up work.
+  Histogram::Snapshot queue_depth;
+};
+
+// Interface for something that can resume coroutines on a (possibly different)
+// thread.
+class Executor {
  public:
-  SerialExecutor();
-  ~SerialExecutor();
+  virtual ~Executor() = default;
 
   // Awaitable that resumes execution of the current coroutine on this executor.
   auto Schedule();
-  // Awaitable that resumes execution of the current coroutine on this executor
-  // after the given time has passed.
-  auto Sleep(absl::Time time);
+
+  // The time according to this executor's clock, which is real time except
+  // for simulated executors. Code that sleeps on an executor should use it
+  // rather than absl::Now().
+  virtual absl::Time Now() const { return absl::Now(); }
+
+  // Resumes execution of the current coroutine on this executor once Now()
+  // has reached `time`. Unless overridden, the executor's thread sleeps until
+  // then, holding up any other coroutines.
+  virtual Task<> Sleep(absl::Time time);
+
+  // Arranges for `handle` to be resumed on this executor.
+  virtual void Enqueue(std::coroutine_handle<> handle) = 0;
+
+  // Returns true if the calling thread is currently running work for this
+  // executor.
+  virtual bool IsCurrent() const = 0;
+
+  // Executors that don't keep metrics return all zeroes.
+  virtual ExecutorMetrics Metrics() const { return {}; }
+
+  // The executor whose thread the caller is running on, or nullptr if it isn't
+  // running on any executor's thread. Also nullptr on the thread of an
+  // executor that has been destroyed, whose remaining work may still run:
+  // executors clear it when destroyed by one of their own coroutines, and
+  // before each coroutine they resume after being destroyed.
+  static Executor* Current() { return current_; }
+
+  // Charges one await point to the slice of the coroutine running on the
+  // current executor, and returns true if the slice has used up its budget
+  // and the coroutine should yield. Always false for executors without a
+  // budget, and off executors.
+  static bool ConsumeSliceBudget();
+
+ protected:
+  // What's left of the budget of the slice running on this thread.
+  struct SliceBudget;
+
+  // Set by executors on each of their threads.
+  static inline thread_local Executor* current_ = nullptr;
+  static thread_local SliceBudget slice_budget_;
+};
+
+struct Executor::SliceBudget {
+  std::uint64_t awaits = std::numeric_limits<std::uint64_t>::max();
+  // In steady_clock nanoseconds.
+  std::int64_t deadline = std::numeric_limits<std::int64_t>::max();
+};
+
+inline thread_local Executor::SliceBudget Executor::slice_budget_;
+
+// Awaitable that moves the current coroutine to the back of its executor's
+// queue, so that the other coroutines waiting on it get to run first. Resumes
+// immediately if not running on an executor.
+auto Yield();
+
+// Allows transferring a coroutine to a different thread than the caller.
+// Coroutines are resumed one at a time in the order they were scheduled.
+class SerialExecutor : public Executor {
+ public:
+  struct Options {
+    // Budget for each slice, the time a resumed coroutine runs before control
+    // returns to the executor, to bound how long other coroutines wait. Once
+    // either limit is reached, the coroutine yields at its next await point
+    // that checks the budget: Schedule() onto the executor it is already on,
+    // or advancing an AsyncGenerator. Zero means unlimited. The time limit is
+    // only checked every 16 await points.
+    std::uint64_t max_slice_awaits = 0;
+    absl::Duration max_slice_time = absl::ZeroDuration();
+
+    // How long the thread spins checking for new work once it has run out,
+    // before parking. Work arriving while it spins is picked up without the
+    // cost of waking a parked thread, which takes microseconds, at the cost
+    // of keeping a core busy. Only worthwhile with cores to spare.
+    absl::Duration idle_spin_time = absl::ZeroDuration();
+    // Never park the thread, spinning instead for as long as the executor is
+    // idle. For low-latency executors with a dedicated core.
+    bool busy_poll = false;
+
+    // CPUs that the thread may run on, or empty for any; see numa.h for the
+    // machine's topology. Handoffs between executors pinned to CPUs sharing a
+    // cache, or at least a NUMA node, are cheaper. The executor's queues are
+    // allocated by its own thread once pinned, which under the default
+    // first-touch policy places them in the node's memory. The constructor
+    // throws std::invalid_argument if the process may not run on one of them.
+    std::vector<int> cpus;
+  };
+
+  explicit SerialExecutor(Options options);
+  SerialExecutor() : SerialExecutor(Options()) {}
+  ~SerialExecutor() override;
+
+  void Enqueue(std::coroutine_handle<> handle) override;
+  bool IsCurrent() const override;
+  ExecutorMetrics Metrics() const override;
 
  private:
   struct SharedState;
 
-  bool AwaitReady() const;
-  void AwaitSuspend(std::coroutine_handle<> pending);
-
   // We use a shared_ptr so that we can asynchronously stop our thread when the
   // executor is destructed.
   std::shared_ptr<SharedState> state_;
   std::jthread thread_;
 };
 
-inline auto SerialExecutor::Schedule() {
+inline auto Executor::Schedule() {
   struct Awaiter {
-    SerialExecutor* executor;
+    Executor* executor;
 
-    bool await_ready() { return executor->AwaitReady(); }
+    bool await_ready() {
+      return executor->IsCurrent() && !ConsumeSliceBudget();
+    }
 
     void await_suspend(std::coroutine_handle<> pending) {
-      executor->AwaitSuspend(pending);
+      executor->Enqueue(pending);
     }
 
     constexpr void await_resume() {}
@@ -50,9 +165,30 @@ inline auto SerialExecutor::Schedule() {
   return Awaiter{this};
 };
 
-inline auto SerialExecutor::Sleep(absl::Time time) {
-  return [](SerialExecutor& executor, absl::Time time) -> Task<> {
-    co_await executor.Schedule();
-    absl::SleepFor(time - absl::Now());
-  }(*this, time);
+inline bool Executor::ConsumeSliceBudget() {
+  SliceBudget& budget = slice_budget_;
+  if (--budget.awaits == 0) {
+    return true;
+  }
+  if (budget.deadline == std::numeric_limits<std::int64_t>::max() ||
+      budget.awaits % 16 != 0) {
+    return false;
+  }
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::nanoseconds(now).count() >= budget.deadline;
+}
+
+inline auto Yield() {
+  struct Awaiter {
+    Executor* executor;
+
+    bool await_ready() { return executor == nullptr; }
+
+    void await_suspend(std::coroutine_handle<> pending) {
+      executor->Enqueue(pending);
+    }
+
+    constexpr void await_resume() {}
+  };
+  return Awaiter{Executor::Current()};
 }
@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+#include "benchmark_util.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+constexpr int kBatchSize = 10'000;
+
+// Latency of a single handoff: the coroutine bounces between two executors, so
+// each hop has to land before the next one starts. The executors use the idle
+// policy given by the arguments.
+static void BM_SchedulePingPong(benchmark::State& state) {
+  auto task = [](SerialExecutor& a, SerialExecutor& b) -> Task<> {
+    for (int i = 0; i < kBatchSize / 2; ++i) {
+      co_await a.Schedule();
+      co_await b.Schedule();
+    }
+  };
+  const SerialExecutor::Options options = {
+      .idle_spin_time = absl::Microseconds(state.range(0)),
+      .busy_poll = static_cast<bool>(state.range(1)),
+  };
+  if ((options.idle_spin_time > absl::ZeroDuration() || options.busy_poll) &&
+      std::thread::hardware_concurrency() < 2) {
+    // Each spinning executor would hold up the other for a whole time slice.
+    state.SkipWithError("Spinning executors need a core each.");
+    return;
+  }
+  SerialExecutor a(options);
+  SerialExecutor b(options);
+  for (auto _ : state) {
+    task(a, b).Wait();
+  }
+  state.SetItemsProcessed(kBatchSize * state.iterations());
+}
+
+// Throughput of handing many independent coroutines to a single executor.
+static void BM_ScheduleThroughput(benchmark::State& state) {
+  auto hop = [](SerialExecutor& executor,
+                std::atomic_int& remaining) -> Detached {
+    co_await executor.Schedule();
+    remaining.fetch_sub(1, std::memory_order::release);
+  };
+  SerialExecutor executor;
+  std::atomic_int remaining;
+  for (auto _ : state) {
+    remaining.store(kBatchSize, std::memory_order::relaxed);
+    for (int i = 0; i < kBatchSize; ++i) {
+      hop(executor, remaining);
+    }
+    SpinUntil(
+        [&] { return remaining.load(std::memory_order::acquire) == 0; });
+  }
+  state.SetItemsProcessed(kBatchSize * state.iterations());
+}
+
+// Awaiting a child task that completes on the same executor, optionally with
+// ResumeOnOrigin(), which should then cost no more than a plain await.
+static void BM_AwaitOnSameExecutor(benchmark::State& state) {
+  auto task = [](SerialExecutor& executor, bool resume_on_origin) -> Task<> {
+    auto child = []() -> Task<int> { co_return 1; };
+    co_await executor.Schedule();
+    for (int i = 0; i < kBatchSize; ++i) {
+      if (resume_on_origin) {
+        benchmark::DoNotOptimize(co_await child().ResumeOnOrigin());
+      } else {
+        benchmark::DoNotOptimize(co_await child());
+      }
+    }
+  };
+  SerialExecutor executor;
+  for (auto _ : state) {
+    task(executor, state.range(0)).Wait();
+  }
+  state.SetItemsProcessed(kBatchSize * state.iterations());
+}
+
+BENCHMARK(BM_SchedulePingPong)
+    ->Args({0, false})
+    ->Args({50, false})
+    ->Args({0, true})
+    ->ArgNames({"spin_us", "busy_poll"})
+    ->UseRealTime();
+BENCHMARK(BM_ScheduleThroughput)->UseRealTime();
+BENCHMARK(BM_AwaitOnSameExecutor)
+    ->Arg(false)
+    ->Arg(true)
+    ->ArgName("resume_on_origin")
+    ->UseRealTime();
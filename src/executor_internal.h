@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+// Building blocks shared by the executors' implementations. Not part of the
+// public API.
+namespace executor_internal {
+
+inline std::int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Single-writer increment of a counter that may be read concurrently; cheaper
+// than fetch_add.
+template <typename I>
+void Add(std::atomic<I>& counter, std::type_identity_t<I> delta) {
+  counter.store(counter.load(std::memory_order::relaxed) + delta,
+                std::memory_order::relaxed);
+}
+
+// Hint to the CPU that we're in a spin loop.
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Tells an executor's single runner thread that there's new work, or that it
+// should stop, waking it only if it's parked. Enqueuers publish their work
+// (typically under a mutex) and then call Notify(). The runner calls Consume()
+// before taking the published work, so that work published after that
+// triggers another round.
+class WorkSignal {
+ public:
+  // Called after publishing work.
+  void Notify() {
+    int previous_state = state_.load(std::memory_order::acquire);
+    // Attempt kIdle/kSpinning -> kPending transition. If we're already in
+    // kPending, the runner will pick up the work in its next round.
+    while (previous_state == kIdle || previous_state == kSpinning) {
+      if (state_.compare_exchange_weak(previous_state, kPending,
+                                       std::memory_order::acq_rel)) {
+        // A spinning runner sees the transition by itself.
+        if (previous_state == kIdle) {
+          state_.notify_one();
+        }
+        return;
+      }
+    }
+  }
+
+  // The runner sees this instead of any further work.
+  void Stop() {
+    state_.store(kStopRequested, std::memory_order::release);
+    state_.notify_one();
+  }
+
+  // The following are only called by the runner.
+
+  // True if there's been no Notify() or Stop() since the last Consume().
+  bool idle() const {
+    return state_.load(std::memory_order::acquire) == kIdle;
+  }
+
+  // Blocks until Notify() or Stop(), if idle.
+  void Park() { state_.wait(kIdle, std::memory_order::relaxed); }
+
+  // Spins until Notify() or Stop(), or until NowNanos() reaches `deadline`.
+  // Returns false if it gave up, in which case the signal is idle again and
+  // the runner should park.
+  bool Spin(std::int64_t deadline) {
+    int previous_state = kIdle;
+    if (!state_.compare_exchange_strong(previous_state, kSpinning,
+                                        std::memory_order::acq_rel)) {
+      // New work or a stop request beat us to it.
+      return true;
+    }
+    for (int i = 1;; ++i) {
+      if (state_.load(std::memory_order::acquire) != kSpinning) {
+        return true;
+      }
+      CpuRelax();
+      // Reading the clock takes longer than a pause, so only do it now and
+      // then.
+      if (i % 64 == 0 && NowNanos() >= deadline) {
+        break;
+      }
+    }
+    previous_state = kSpinning;
+    // Work may have arrived after we last looked.
+    return !state_.compare_exchange_strong(previous_state, kIdle,
+                                           std::memory_order::acq_rel);
+  }
+
+  // Resets the signal after a Notify(), before taking the published work.
+  // Returns false if a stop was requested instead.
+  bool Consume() {
+    int previous_state = kPending;
+    if (!state_.compare_exchange_strong(previous_state, kIdle,
+                                        std::memory_order::acq_rel)) {
+      // Racing stop request.
+      assert(previous_state == kStopRequested);
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  enum : int {
+    // No new work since the runner last looked.
+    kIdle,
+    // As kIdle, but the runner is spinning rather than parked, so it doesn't
+    // need to be notified of new work.
+    kSpinning,
+    kPending,
+    kStopRequested,
+  };
+
+  std::atomic_int state_ = kIdle;
+};
+
+}  // namespace executor_internal
@@ -3,8 +3,19 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "diy/coro/async_generator.h"
+#include "diy/coro/blocking_pool.h"
 #include "diy/coro/task.h"
 
+using testing::ElementsAre;
+
 TEST(ExecutorTest, ThreadIdMatches) {
   auto task = [](SerialExecutor& executor) -> Task<std::thread::id> {
     co_await executor.Schedule();
@@ -15,6 +26,18 @@ TEST(ExecutorTest, ThreadIdMatches) {
   EXPECT_NE(task(executor).Wait(), std::this_thread::get_id());
 }
 
+TEST(ExecutorTest, Current) {
+  auto task = []() -> Task<Executor*> { co_return Executor::Current(); };
+  auto scheduled = [](SerialExecutor& executor) -> Task<Executor*> {
+    co_await executor.Schedule();
+    co_return Executor::Current();
+  };
+
+  SerialExecutor executor;
+  EXPECT_EQ(task().Wait(), nullptr);
+  EXPECT_EQ(scheduled(executor).Wait(), &executor);
+}
+
 // It should be possible for a child coroutine to schedule onto the same
 // executor that the parent is running on.
 TEST(ExecutorTest, RecursiveScheduling) {
@@ -57,3 +80,249 @@ TEST(ExecutorTest, ScopedWithinCoroutine) {
 
   task().Wait();
 }
+
+TEST(ExecutorTest, DestroyedByOwnCoroutine) {
+  auto task = []() -> Task<int> {
+    std::optional<SerialExecutor> executor;
+    executor.emplace();
+    co_await executor->Schedule();
+    executor.reset();
+    EXPECT_EQ(Executor::Current(), nullptr);
+    // Would otherwise try to return to the destroyed executor.
+    co_return co_await Offload([] { return 1; });
+  };
+
+  EXPECT_EQ(task().Wait(), 1);
+}
+
+TEST(ExecutorTest, Metrics) {
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+    absl::SleepFor(absl::Milliseconds(10));
+  };
+
+  SerialExecutor executor;
+  for (int i = 0; i < 3; ++i) {
+    const std::uint64_t parks = executor.Metrics().parks;
+    task(executor).Wait();
+    // Wait() may return before the task has returned control to the executor.
+    // Once the executor has parked again, the task has been fully accounted
+    // for, and the next one can't arrive before the executor runs out of work.
+    while (executor.Metrics().parks == parks) {
+      std::this_thread::yield();
+    }
+  }
+  const ExecutorMetrics metrics = executor.Metrics();
+  EXPECT_EQ(metrics.enqueued, 3);
+  EXPECT_EQ(metrics.resumed, 3);
+  EXPECT_GE(metrics.parks, 3);
+  EXPECT_EQ(metrics.queue_depth.count(), 3);
+  EXPECT_EQ(metrics.queue_depth.max(), 1);
+  EXPECT_EQ(metrics.schedule_delay_ns.count(), 3);
+  EXPECT_EQ(metrics.slice_ns.count(), 3);
+  EXPECT_GE(metrics.slice_ns.Percentile(0),
+            absl::ToInt64Nanoseconds(absl::Milliseconds(9)));
+}
+
+TEST(ExecutorTest, IdleSpinAvoidsParking) {
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+  };
+
+  SerialExecutor executor({.idle_spin_time = absl::Seconds(10)});
+  for (int i = 0; i < 3; ++i) {
+    task(executor).Wait();
+  }
+  EXPECT_EQ(executor.Metrics().parks, 0);
+}
+
+TEST(ExecutorTest, ParksAfterIdleSpin) {
+  SerialExecutor executor({.idle_spin_time = absl::Milliseconds(1)});
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (executor.Metrics().parks == 0 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(executor.Metrics().parks, 1);
+
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+  };
+  task(executor).Wait();
+  EXPECT_EQ(executor.Metrics().enqueued, 1);
+}
+
+TEST(ExecutorTest, BusyPoll) {
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+  };
+
+  SerialExecutor executor({.busy_poll = true});
+  for (int i = 0; i < 3; ++i) {
+    task(executor).Wait();
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(executor.Metrics().parks, 0);
+}
+
+TEST(ExecutorTest, AwaitContinuesOnChildExecutor) {
+  auto child = [](SerialExecutor& b) -> Task<> { co_await b.Schedule(); };
+  auto parent = [&](SerialExecutor& a, SerialExecutor& b) -> Task<bool> {
+    co_await a.Schedule();
+    co_await child(b);
+    co_return b.IsCurrent();
+  };
+
+  SerialExecutor a;
+  SerialExecutor b;
+  EXPECT_TRUE(parent(a, b).Wait());
+}
+
+TEST(ExecutorTest, ResumeOnOrigin) {
+  auto child = [](SerialExecutor& b) -> Task<int> {
+    co_await b.Schedule();
+    co_return 1;
+  };
+  auto parent = [&](SerialExecutor& a, SerialExecutor& b) -> Task<bool> {
+    co_await a.Schedule();
+    EXPECT_EQ(co_await child(b).ResumeOnOrigin(), 1);
+    co_return a.IsCurrent();
+  };
+
+  SerialExecutor a;
+  SerialExecutor b;
+  EXPECT_TRUE(parent(a, b).Wait());
+}
+
+TEST(ExecutorTest, ResumeOnOriginException) {
+  auto child = [](SerialExecutor& b) -> Task<> {
+    co_await b.Schedule();
+    throw std::runtime_error("error");
+  };
+  auto parent = [&](SerialExecutor& a, SerialExecutor& b) -> Task<bool> {
+    co_await a.Schedule();
+    EXPECT_THROW(co_await child(b).ResumeOnOrigin(), std::runtime_error);
+    co_return a.IsCurrent();
+  };
+
+  SerialExecutor a;
+  SerialExecutor b;
+  EXPECT_TRUE(parent(a, b).Wait());
+}
+
+// Resuming on the same executor doesn't go through its queue.
+TEST(ExecutorTest, ResumeOnOriginSameExecutor) {
+  auto child = []() -> Task<int> { co_return 1; };
+  auto parent = [&](SerialExecutor& a) -> Task<> {
+    co_await a.Schedule();
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_EQ(co_await child().ResumeOnOrigin(), 1);
+    }
+  };
+
+  SerialExecutor a;
+  parent(a).Wait();
+  EXPECT_EQ(a.Metrics().enqueued, 1);
+}
+
+TEST(ExecutorTest, Yield) {
+  auto task = [](SerialExecutor& executor, std::vector<int>& order,
+                 int id) -> Task<> {
+    co_await executor.Schedule();
+    // Wait for both tasks to be queued.
+    while (executor.Metrics().enqueued < 2) {
+      std::this_thread::yield();
+    }
+    for (int i = 0; i < 3; ++i) {
+      order.push_back(id);
+      co_await Yield();
+    }
+  };
+
+  SerialExecutor executor;
+  std::vector<int> order;
+  {
+    std::jthread first([&] { task(executor, order, 1).Wait(); });
+    while (executor.Metrics().enqueued < 1) {
+      std::this_thread::yield();
+    }
+    std::jthread second([&] { task(executor, order, 2).Wait(); });
+  }
+  EXPECT_THAT(order, ElementsAre(1, 2, 1, 2, 1, 2));
+}
+
+TEST(ExecutorTest, YieldOffExecutor) {
+  auto task = []() -> Task<Executor*> {
+    co_await Yield();
+    co_return Executor::Current();
+  };
+  EXPECT_EQ(task().Wait(), nullptr);
+}
+
+namespace {
+
+// Consumes a fast generator on `executor`, while another coroutine is queued
+// behind it. Returns how many values were consumed before the other coroutine
+// got to run.
+int ValuesBeforeOtherCoroutineRuns(SerialExecutor& executor) {
+  constexpr int kValues = 100;
+  std::atomic_bool other_ran = false;
+  auto other = [&]() -> Task<> {
+    co_await executor.Schedule();
+    other_ran = true;
+  };
+  auto consume = [&]() -> Task<int> {
+    co_await executor.Schedule();
+    while (executor.Metrics().enqueued < 2) {
+      std::this_thread::yield();
+    }
+    auto values = []() -> AsyncGenerator<int> {
+      for (int i = 0; i < kValues; ++i) {
+        co_yield i;
+      }
+    }();
+    int consumed = 0;
+    while (co_await values && !other_ran) {
+      ++consumed;
+    }
+    co_return consumed;
+  };
+  int consumed;
+  std::jthread consumer([&] { consumed = consume().Wait(); });
+  while (executor.Metrics().enqueued < 1) {
+    std::this_thread::yield();
+  }
+  other().Wait();
+  consumer.join();
+  return consumed;
+}
+
+}  // namespace
+
+TEST(ExecutorTest, NoSliceBudget) {
+  SerialExecutor executor;
+  EXPECT_EQ(ValuesBeforeOtherCoroutineRuns(executor), 100);
+}
+
+TEST(ExecutorTest, SliceAwaitBudget) {
+  SerialExecutor executor({.max_slice_awaits = 10});
+  EXPECT_LT(ValuesBeforeOtherCoroutineRuns(executor), 10);
+}
+
+TEST(ExecutorTest, SliceTimeBudget) {
+  SerialExecutor executor({.max_slice_time = absl::Nanoseconds(1)});
+  EXPECT_LT(ValuesBeforeOtherCoroutineRuns(executor), 16);
+}
+
+// Schedule() onto the current executor yields once the budget is used up.
+TEST(ExecutorTest, SliceBudgetOnSchedule) {
+  auto task = [](SerialExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+    for (int i = 0; i < 25; ++i) {
+      co_await executor.Schedule();
+    }
+  };
+
+  SerialExecutor executor({.max_slice_awaits = 10});
+  task(executor).Wait();
+  EXPECT_EQ(executor.Metrics().enqueued, 3);
+}
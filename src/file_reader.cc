@@ -0,0 +1,293 @@
+#include "diy/coro/file_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "diy/coro/event.h"
+#include "diy/coro/executor.h"
+
+namespace {
+
+[[noreturn]] void ThrowErrno(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Read-only file descriptor, closed on destruction.
+class File {
+ public:
+  explicit File(const std::string& path)
+      : path_(path), fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+    if (fd_ < 0) {
+      ThrowErrno(path_);
+    }
+    // Only a hint; failure is harmless.
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+
+  ~File() { ::close(fd_); }
+
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+
+  const std::string& path() const { return path_; }
+  int fd() const { return fd_; }
+
+  std::size_t Size() const {
+    struct stat stat;
+    if (::fstat(fd_, &stat) != 0) {
+      ThrowErrno(path_);
+    }
+    return stat.st_size;
+  }
+
+  // Fills `buffer` from `offset` onwards, returning fewer bytes only if the end
+  // of the file is reached.
+  std::size_t ReadAt(std::span<std::byte> buffer, off_t offset) const {
+    std::size_t total = 0;
+    while (total < buffer.size()) {
+      const ssize_t n = ::pread(fd_, buffer.data() + total,
+                                buffer.size() - total, offset + total);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        ThrowErrno(path_);
+      }
+      if (n == 0) {
+        break;
+      }
+      total += n;
+    }
+    return total;
+  }
+
+ private:
+  const std::string path_;
+  const int fd_;
+};
+
+// One chunk's buffer, and the read into it that may be in progress.
+struct PendingRead {
+  std::span<std::byte> buffer;
+  off_t offset = 0;
+  // Results, written by the read thread before `done` is notified.
+  std::size_t size = 0;
+  std::exception_ptr exception;
+  std::optional<Event> done;
+};
+
+// Performs reads of a file one at a time, in submission order, on a dedicated
+// thread. Destruction abandons any reads that haven't started yet, and waits
+// for the current one to finish.
+class ReadThread {
+ public:
+  explicit ReadThread(const File& file)
+      : file_(file),
+        thread_([this](std::stop_token stop_token) { Run(stop_token); }) {}
+
+  // Starts reading into `read.buffer`; `read` must stay alive until
+  // `read.done` is notified or this is destroyed.
+  void Submit(PendingRead& read) {
+    read.done.emplace();
+    {
+      auto lock = std::lock_guard(mutex_);
+      queue_.push_back(&read);
+    }
+    submitted_.notify_one();
+  }
+
+  bool IsCurrent() const {
+    return std::this_thread::get_id() == thread_.get_id();
+  }
+
+ private:
+  void Run(std::stop_token stop_token) {
+    while (true) {
+      PendingRead* read;
+      {
+        auto lock = std::unique_lock(mutex_);
+        if (!submitted_.wait(lock, stop_token,
+                             [&] { return !queue_.empty(); })) {
+          return;
+        }
+        read = queue_.front();
+        queue_.pop_front();
+      }
+      try {
+        read->size = file_.ReadAt(read->buffer, read->offset);
+      } catch (...) {
+        read->exception = std::current_exception();
+      }
+      // Resumes the consumer inline if it is already waiting.
+      read->done->Notify();
+    }
+  }
+
+  const File& file_;
+  std::mutex mutex_;
+  std::condition_variable_any submitted_;
+  std::deque<PendingRead*> queue_;
+  // Last, so that the thread is stopped before the rest is destroyed.
+  std::jthread thread_;
+};
+
+// Read-only mapping of a whole file, unmapped on destruction.
+class Mapping {
+ public:
+  explicit Mapping(const File& file) : size_(file.Size()) {
+    // Empty mappings aren't allowed.
+    if (size_ == 0) {
+      return;
+    }
+    void* data =
+        ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file.fd(), /*offset=*/0);
+    if (data == MAP_FAILED) {
+      ThrowErrno(file.path());
+    }
+    data_ = static_cast<const char*>(data);
+    // Only hints; failure is harmless.
+    ::madvise(data, size_, MADV_SEQUENTIAL);
+  }
+
+  ~Mapping() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  Mapping(const Mapping&) = delete;
+  Mapping& operator=(const Mapping&) = delete;
+
+  std::string_view contents() const { return {data_, size_}; }
+
+  // Asks the kernel to start reading in `length` bytes from `offset`, which
+  // must be a multiple of the page size.
+  void WillNeed(std::size_t offset, std::size_t length) const {
+    length = std::min(length, size_ - offset);
+    ::madvise(const_cast<char*>(data_) + offset, length, MADV_WILLNEED);
+  }
+
+ private:
+  const std::size_t size_;
+  const char* data_ = nullptr;
+};
+
+Generator<std::string_view> SplitRecords(std::unique_ptr<const Mapping> mapping,
+                                         char delimiter) {
+  // Multiple of the page size, and larger than the kernel's default readahead.
+  constexpr std::size_t kReadahead = 4 << 20;
+  const std::string_view contents = mapping->contents();
+  // End of the range that readahead has been requested for.
+  std::size_t advised = 0;
+  std::size_t start = 0;
+  while (start < contents.size()) {
+    // Stay between one and two windows ahead.
+    if (advised < contents.size() && start + kReadahead > advised) {
+      mapping->WillNeed(advised, kReadahead);
+      advised += kReadahead;
+    }
+    // memchr() is vectorized by the C library.
+    const void* found = std::memchr(contents.data() + start, delimiter,
+                                    contents.size() - start);
+    const std::size_t end =
+        found == nullptr ? contents.size()
+                         : static_cast<const char*>(found) - contents.data();
+    co_yield contents.substr(start, end - start);
+    start = end + 1;
+  }
+}
+
+}  // namespace
+
+AsyncGenerator<std::span<const std::byte>> ReadFileChunks(
+    std::string path, std::size_t chunk_size, std::size_t depth) {
+  assert(chunk_size > 0);
+  assert(depth > 0);
+  const File file(path);
+  const std::size_t file_size = file.Size();
+
+  // One buffer for each read in flight, plus one for the chunk being consumed.
+  std::vector<PendingRead> reads(depth + 1);
+  const auto storage =
+      std::make_unique_for_overwrite<std::byte[]>(chunk_size * reads.size());
+  for (std::size_t i = 0; i < reads.size(); ++i) {
+    reads[i].buffer = {&storage[i * chunk_size], chunk_size};
+  }
+
+  // Where the consumer runs after waiting on a read if it wasn't on an
+  // executor, so that its processing doesn't hold up the reads behind it.
+  // Created on first use.
+  std::optional<SerialExecutor> fallback;
+  ReadThread read_thread(file);
+
+  off_t offset = 0;
+  std::size_t submitted = 0;
+  auto submit_next = [&] {
+    if (static_cast<std::size_t>(offset) >= file_size) {
+      return;
+    }
+    PendingRead& read = reads[submitted++ % reads.size()];
+    read.offset = offset;
+    offset += chunk_size;
+    read_thread.Submit(read);
+  };
+
+  for (std::size_t i = 0; i < depth; ++i) {
+    submit_next();
+  }
+  for (std::size_t consumed = 0; consumed < submitted; ++consumed) {
+    PendingRead& read = reads[consumed % reads.size()];
+    // We're running on the consumer's thread here.
+    Executor* consumer = Executor::Current();
+    co_await *read.done;
+    if (read_thread.IsCurrent()) {
+      if (consumer == nullptr) {
+        if (!fallback) {
+          fallback.emplace();
+        }
+        consumer = &*fallback;
+      }
+      co_await consumer->Schedule();
+    }
+    if (read.exception) {
+      std::rethrow_exception(read.exception);
+    }
+    if (read.size == 0) {
+      // The file was truncated while we were reading it.
+      co_return;
+    }
+    // The consumer is done with the previous chunk, so its buffer can be
+    // refilled while this one is processed.
+    submit_next();
+    co_yield read.buffer.first(read.size);
+  }
+}
+
+Generator<std::string_view> MappedRecords(const std::string& path,
+                                          char delimiter) {
+  // Coroutine parameters outlive the coroutine body, unlike its locals, so the
+  // mapping stays valid until the generator is destroyed.
+  return SplitRecords(std::make_unique<const Mapping>(File(path)), delimiter);
+}
+
+Generator<std::string_view> MappedLines(const std::string& path) {
+  return MappedRecords(path, '\n');
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "diy/coro/async_generator.h"
+#include "diy/coro/generator.h"
+
+// Streams the contents of the file at `path` in chunks of `chunk_size` bytes;
+// the last chunk may be shorter. Reads are performed on a dedicated thread,
+// which keeps up to `depth` chunks read ahead of the consumer so that disk
+// reads overlap with processing of earlier chunks.
+//
+//   auto chunks = ReadFileChunks(path, 1 << 20);
+//   while (std::span<const std::byte>* chunk = co_await chunks) {
+//     Process(*chunk);
+//   }
+//
+// Chunks are read into a fixed set of `depth + 1` buffers, and each yielded
+// span is only valid until the generator is next advanced. When the consumer
+// has to wait for a read, it is resumed on the executor it was running on, or
+// if none, on a thread owned by the generator. Throws std::system_error if the
+// file can't be opened or read.
+AsyncGenerator<std::span<const std::byte>> ReadFileChunks(
+    std::string path, std::size_t chunk_size, std::size_t depth = 2);
+
+// Memory-maps the file at `path` and yields each record ending in `delimiter`,
+// without the delimiter, as a view into the mapping; the final record need
+// not be terminated. No data is copied. Views remain valid for as long as the
+// generator is alive, so they may be retained across iterations. The kernel is
+// told the mapping will be read sequentially, and asked to read ahead of the
+// current position. Throws std::system_error if the file can't be mapped.
+//
+// The file must not be truncated while mapped, as accessing the mapping past
+// its new end raises SIGBUS.
+Generator<std::string_view> MappedRecords(const std::string& path,
+                                          char delimiter);
+
+// Equivalent to MappedRecords(path, '\n').
+Generator<std::string_view> MappedLines(const std::string& path);
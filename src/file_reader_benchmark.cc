@@ -0,0 +1,175 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "diy/coro/file_reader.h"
+#include "diy/coro/generator.h"
+#include "diy/coro/task.h"
+
+namespace {
+
+constexpr std::size_t kFileSize = 64 << 20;
+constexpr std::size_t kChunkSize = 1 << 20;
+
+// Temporary file of kFileSize bytes made up of copies of `pattern`, removed on
+// destruction.
+class TestFile {
+ public:
+  TestFile(const std::string& name, std::string_view pattern)
+      : path_("/tmp/" + name + "." + std::to_string(::getpid())) {
+    std::ofstream out(path_, std::ios::binary | std::ios::trunc);
+    for (std::size_t i = 0; i < kFileSize / pattern.size(); ++i) {
+      out << pattern;
+    }
+  }
+  ~TestFile() { std::remove(path_.c_str()); }
+
+  const std::string& path() const { return path_; }
+
+  // Drops the file from the page cache, so that the next pass reads it from
+  // disk.
+  void Evict() const {
+    const int fd = ::open(path_.c_str(), O_RDONLY);
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+
+ private:
+  std::string path_;
+};
+
+const TestFile& ChunksFile() {
+  static const TestFile file("file_reader_benchmark_chunks",
+                             std::string(kChunkSize, 'x'));
+  return file;
+}
+
+// Lines of 64 bytes, newline included.
+const TestFile& LinesFile() {
+  static const TestFile file("file_reader_benchmark_lines",
+                             std::string(63, 'x') + "\n");
+  return file;
+}
+
+// Stand-in for per-chunk work, roughly as expensive as reading the chunk from
+// the page cache.
+std::uint64_t Process(std::span<const std::byte> chunk) {
+  std::uint64_t hash = 0;
+  for (std::size_t i = 0; i + sizeof(hash) <= chunk.size(); i += sizeof(hash)) {
+    std::uint64_t word;
+    std::memcpy(&word, &chunk[i], sizeof(word));
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15;
+  }
+  return hash;
+}
+
+// A blocking read loop wrapped in an AsyncGenerator, which reads each chunk
+// only once the consumer asks for it.
+AsyncGenerator<std::span<const std::byte>> BlockingChunks(std::string path) {
+  std::ifstream in(path, std::ios::binary);
+  std::vector<std::byte> buffer(kChunkSize);
+  while (in.read(reinterpret_cast<char*>(buffer.data()), buffer.size()) ||
+         in.gcount() > 0) {
+    co_yield std::span<const std::byte>(buffer.data(), in.gcount());
+  }
+}
+
+Task<std::uint64_t> Consume(AsyncGenerator<std::span<const std::byte>> chunks) {
+  std::uint64_t hash = 0;
+  while (std::span<const std::byte>* chunk = co_await chunks) {
+    hash ^= Process(*chunk);
+  }
+  co_return hash;
+}
+
+// Copies each line into a std::string, as log-replay tools used to.
+Generator<std::string> CopiedLines(std::string path) {
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    co_yield line;
+  }
+}
+
+// Stand-in for parsing a line.
+std::size_t Parse(std::string_view line) { return line.size() + line.back(); }
+
+}  // namespace
+
+static void BM_BlockingRead(benchmark::State& state) {
+  const TestFile& file = ChunksFile();
+  for (auto _ : state) {
+    if (state.range(0)) {
+      state.PauseTiming();
+      file.Evict();
+      state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(Consume(BlockingChunks(file.path())).Wait());
+  }
+  state.SetBytesProcessed(kFileSize * state.iterations());
+}
+
+static void BM_ReadFileChunks(benchmark::State& state) {
+  const TestFile& file = ChunksFile();
+  for (auto _ : state) {
+    if (state.range(1)) {
+      state.PauseTiming();
+      file.Evict();
+      state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(
+        Consume(ReadFileChunks(file.path(), kChunkSize, state.range(0)))
+            .Wait());
+  }
+  state.SetBytesProcessed(kFileSize * state.iterations());
+}
+
+// "cold" benchmarks read the file from disk rather than the page cache.
+BENCHMARK(BM_BlockingRead)
+    ->Arg(false)
+    ->Arg(true)
+    ->ArgName("cold")
+    ->UseRealTime();
+BENCHMARK(BM_ReadFileChunks)
+    ->ArgsProduct({{1, 2, 4}, {false, true}})
+    ->ArgNames({"depth", "cold"})
+    ->UseRealTime();
+
+static void BM_CopiedLines(benchmark::State& state) {
+  const TestFile& file = LinesFile();
+  for (auto _ : state) {
+    std::size_t total = 0;
+    for (const std::string& line : CopiedLines(file.path())) {
+      total += Parse(line);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(kFileSize * state.iterations());
+}
+
+static void BM_MappedLines(benchmark::State& state) {
+  const TestFile& file = LinesFile();
+  for (auto _ : state) {
+    std::size_t total = 0;
+    for (std::string_view line : MappedLines(file.path())) {
+      total += Parse(line);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(kFileSize * state.iterations());
+}
+
+BENCHMARK(BM_CopiedLines);
+BENCHMARK(BM_MappedLines);
@@ -0,0 +1,183 @@
+#include "diy/coro/file_reader.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+using testing::SizeIs;
+
+namespace {
+
+std::string WriteContents(const std::string& name, std::string_view contents) {
+  const std::string path = testing::TempDir() + name;
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+  return path;
+}
+
+// Writes a file of `size` bytes with varying contents, and returns its path.
+std::string WriteFile(const std::string& name, std::size_t size) {
+  const std::string path = testing::TempDir() + name;
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  for (std::size_t i = 0; i < size; ++i) {
+    out.put(static_cast<char>(i % 251));
+  }
+  return path;
+}
+
+std::string ToString(std::span<const std::byte> chunk) {
+  return {reinterpret_cast<const char*>(chunk.data()), chunk.size()};
+}
+
+// Reads the whole file, returning the size of each chunk and their
+// concatenated contents.
+Task<std::pair<std::vector<std::size_t>, std::string>> ReadAll(
+    AsyncGenerator<std::span<const std::byte>> chunks) {
+  std::vector<std::size_t> sizes;
+  std::string contents;
+  while (std::span<const std::byte>* chunk = co_await chunks) {
+    sizes.push_back(chunk->size());
+    contents += ToString(*chunk);
+  }
+  co_return std::make_pair(sizes, contents);
+}
+
+std::string ReadWithStream(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+}  // namespace
+
+TEST(FileReaderTest, ReadsWholeFile) {
+  const std::string path = WriteFile("whole", 10'000);
+  const auto [sizes, contents] = ReadAll(ReadFileChunks(path, 4096)).Wait();
+  EXPECT_THAT(sizes, ElementsAre(4096, 4096, 1808));
+  EXPECT_EQ(contents, ReadWithStream(path));
+}
+
+TEST(FileReaderTest, ExactMultipleOfChunkSize) {
+  const std::string path = WriteFile("multiple", 3 * 1024);
+  const auto [sizes, contents] = ReadAll(ReadFileChunks(path, 1024)).Wait();
+  EXPECT_THAT(sizes, ElementsAre(1024, 1024, 1024));
+  EXPECT_EQ(contents, ReadWithStream(path));
+}
+
+TEST(FileReaderTest, EmptyFile) {
+  const std::string path = WriteFile("empty", 0);
+  const auto [sizes, contents] = ReadAll(ReadFileChunks(path, 1024)).Wait();
+  EXPECT_THAT(sizes, IsEmpty());
+}
+
+TEST(FileReaderTest, Depths) {
+  const std::string path = WriteFile("depths", 100'000);
+  const std::string expected = ReadWithStream(path);
+  for (std::size_t depth : {1, 2, 8, 64}) {
+    const auto [sizes, contents] =
+        ReadAll(ReadFileChunks(path, 1000, depth)).Wait();
+    EXPECT_THAT(sizes, SizeIs(100)) << depth;
+    EXPECT_EQ(contents, expected) << depth;
+  }
+}
+
+TEST(FileReaderTest, ResumesOnConsumerExecutor) {
+  const std::string path = WriteFile("executor", 100'000);
+  auto consume = [](SerialExecutor& executor,
+                    std::string path) -> Task<std::size_t> {
+    co_await executor.Schedule();
+    auto chunks = ReadFileChunks(path, 1000);
+    std::size_t count = 0;
+    while (co_await chunks) {
+      EXPECT_TRUE(executor.IsCurrent());
+      ++count;
+    }
+    co_return count;
+  };
+
+  SerialExecutor executor;
+  EXPECT_EQ(consume(executor, path).Wait(), 100);
+}
+
+TEST(FileReaderTest, AbandonedPartwayThrough) {
+  const std::string path = WriteFile("abandoned", 100'000);
+  auto chunks = ReadFileChunks(path, 1000, 8);
+  std::span<const std::byte>* chunk = chunks.Wait();
+  ASSERT_NE(chunk, nullptr);
+  EXPECT_EQ(ToString(*chunk), ReadWithStream(path).substr(0, 1000));
+}
+
+TEST(FileReaderTest, MissingFile) {
+  auto chunks = ReadFileChunks(testing::TempDir() + "missing", 1024);
+  EXPECT_THROW(chunks.Wait(), std::system_error);
+}
+
+TEST(MappedRecordsTest, Lines) {
+  const std::string path = WriteContents("lines", "first\n\nthird\nlast");
+  // Views are only valid while the generator is alive.
+  auto generator = MappedLines(path);
+  std::vector<std::string_view> lines;
+  for (std::string_view line : generator) {
+    lines.push_back(line);
+  }
+  EXPECT_THAT(lines, ElementsAre("first", "", "third", "last"));
+}
+
+TEST(MappedRecordsTest, TrailingDelimiter) {
+  const std::string path = WriteContents("trailing", "a\nb\n");
+  auto generator = MappedLines(path);
+  std::vector<std::string_view> lines;
+  for (std::string_view line : generator) {
+    lines.push_back(line);
+  }
+  EXPECT_THAT(lines, ElementsAre("a", "b"));
+}
+
+TEST(MappedRecordsTest, Delimiter) {
+  using namespace std::string_view_literals;
+  const std::string path = WriteContents("records", "a\nb\0c\0"sv);
+  auto generator = MappedRecords(path, '\0');
+  std::vector<std::string_view> records;
+  for (std::string_view record : generator) {
+    records.push_back(record);
+  }
+  EXPECT_THAT(records, ElementsAre("a\nb", "c"));
+}
+
+TEST(MappedRecordsTest, EmptyFile) {
+  const std::string path = WriteContents("empty_records", "");
+  auto lines = MappedLines(path);
+  EXPECT_EQ(lines.begin(), lines.end());
+}
+
+// Spans several readahead windows, and keeps every view until the end.
+TEST(MappedRecordsTest, LargeFile) {
+  std::string contents;
+  for (int i = 0; contents.size() < (10 << 20); ++i) {
+    contents += std::to_string(i) + "\n";
+  }
+  const std::string path = WriteContents("large_records", contents);
+
+  auto lines = MappedLines(path);
+  std::vector<std::string_view> views(lines.begin(), lines.end());
+  std::string joined;
+  for (std::string_view view : views) {
+    joined.append(view).push_back('\n');
+  }
+  EXPECT_EQ(joined, contents);
+}
+
+TEST(MappedRecordsTest, MissingFile) {
+  EXPECT_THROW(MappedLines(testing::TempDir() + "missing"), std::system_error);
+}
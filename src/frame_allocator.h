@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <source_location>
+#include <type_traits>
+#include <utility>
+
+#include "diy/coro/arena.h"
+#include "diy/coro/frame_stats.h"
+
+// Control over where coroutine frames are allocated. A coroutine whose promise
+// type derives from AllocatedFrame may take `std::allocator_arg_t` and an
+// allocator as its leading parameters (following the object parameter, for
+// member functions and lambdas), and its frame is then allocated with that
+// allocator:
+//
+//   Task<int> Handle(std::allocator_arg_t, Alloc alloc, Request request);
+//   co_await Handle(std::allocator_arg, alloc, std::move(request));
+//
+// The allocator is copied into the frame and used again to free it, so it only
+// has to be valid for as long as its memory is. Frames of other coroutines are
+// allocated from the current Arena if there is one, and otherwise with the
+// global operator new, or attributed to their call site if frame_stats is
+// enabled; frames from custom allocators and arenas are not tracked.
+namespace frame_allocator {
+
+// Base class for promise types.
+template <typename Promise>
+struct AllocatedFrame {
+  static void* operator new(
+      std::size_t size,
+      std::source_location location = std::source_location::current());
+
+  // Free functions and static member functions.
+  template <typename Alloc, typename... Args>
+  static void* operator new(std::size_t size, std::allocator_arg_t,
+                            const Alloc& alloc, const Args&...) {
+    return Allocate(size, alloc);
+  }
+
+  // Non-static member functions and lambdas.
+  template <typename Self, typename Alloc, typename... Args>
+  static void* operator new(std::size_t size, const Self&, std::allocator_arg_t,
+                            const Alloc& alloc, const Args&...) {
+    return Allocate(size, alloc);
+  }
+
+  static void operator delete(void* frame, std::size_t size);
+
+ private:
+  // Stored after each frame, to free it with the same allocator that
+  // allocated it. Followed by the allocator itself, if custom.
+  using Deallocator = void (*)(void* frame, std::size_t size);
+
+  // Unit of allocation for custom allocators; aligned as the global operator
+  // new would.
+  struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Block {
+    std::byte bytes[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+  };
+
+  static constexpr std::size_t RoundUp(std::size_t size, std::size_t align) {
+    return (size + align - 1) / align * align;
+  }
+
+  static constexpr std::size_t DeallocatorOffset(std::size_t size) {
+    return RoundUp(size, alignof(Deallocator));
+  }
+
+  template <typename Alloc>
+  static constexpr std::size_t AllocatorOffset(std::size_t size) {
+    return RoundUp(DeallocatorOffset(size) + sizeof(Deallocator),
+                   alignof(Alloc));
+  }
+
+  template <typename Alloc>
+  static constexpr std::size_t BlockCount(std::size_t size) {
+    return RoundUp(AllocatorOffset<Alloc>(size) + sizeof(Alloc),
+                   sizeof(Block)) /
+           sizeof(Block);
+  }
+
+  template <typename T>
+  static T* At(void* frame, std::size_t offset) {
+    return std::launder(
+        reinterpret_cast<T*>(static_cast<std::byte*>(frame) + offset));
+  }
+
+  template <typename Alloc>
+  static void* Allocate(std::size_t size, const Alloc& alloc);
+
+  static void* Allocate(std::size_t size, Arena& arena);
+
+  template <typename Alloc>
+  static void Deallocate(void* frame, std::size_t size);
+};
+
+////////////////////
+// Implementation //
+////////////////////
+
+template <typename Promise>
+void* AllocatedFrame<Promise>::operator new(std::size_t size,
+                                            std::source_location location) {
+  if (Arena* arena = Arena::Current()) {
+    return Allocate(size, *arena);
+  }
+  const std::size_t total = DeallocatorOffset(size) + sizeof(Deallocator);
+  void* frame;
+  Deallocator deallocate;
+  if constexpr (frame_stats::kEnabled) {
+    using Tracked = frame_stats::TrackedFrame<Promise, true>;
+    frame = Tracked::operator new(total, location);
+    deallocate = [](void* frame, std::size_t size) {
+      Tracked::operator delete(frame,
+                               DeallocatorOffset(size) + sizeof(Deallocator));
+    };
+  } else {
+    frame = ::operator new(total);
+    deallocate = [](void* frame, std::size_t size) {
+      ::operator delete(frame, DeallocatorOffset(size) + sizeof(Deallocator));
+    };
+  }
+  ::new (static_cast<std::byte*>(frame) + DeallocatorOffset(size))
+      Deallocator(deallocate);
+  return frame;
+}
+
+template <typename Promise>
+void AllocatedFrame<Promise>::operator delete(void* frame, std::size_t size) {
+  (*At<Deallocator>(frame, DeallocatorOffset(size)))(frame, size);
+}
+
+template <typename Promise>
+template <typename Alloc>
+void* AllocatedFrame<Promise>::Allocate(std::size_t size, const Alloc& alloc) {
+  using Rebound =
+      typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+  static_assert(alignof(Rebound) <= alignof(Block));
+  Rebound rebound(alloc);
+  void* frame = std::to_address(std::allocator_traits<Rebound>::allocate(
+      rebound, BlockCount<Rebound>(size)));
+  auto* base = static_cast<std::byte*>(frame);
+  ::new (base + DeallocatorOffset(size)) Deallocator(&Deallocate<Rebound>);
+  ::new (base + AllocatorOffset<Rebound>(size)) Rebound(std::move(rebound));
+  return frame;
+}
+
+template <typename Promise>
+void* AllocatedFrame<Promise>::Allocate(std::size_t size, Arena& arena) {
+  // The arena is stored after the deallocator, in place of an allocator.
+  const std::size_t arena_offset = AllocatorOffset<Arena*>(size);
+  void* frame = arena.Allocate(arena_offset + sizeof(Arena*));
+  auto* base = static_cast<std::byte*>(frame);
+  ::new (base + DeallocatorOffset(size))
+      Deallocator([](void* frame, std::size_t size) {
+        (*At<Arena*>(frame, AllocatorOffset<Arena*>(size)))->Free();
+      });
+  ::new (base + arena_offset) Arena*(&arena);
+  return frame;
+}
+
+template <typename Promise>
+template <typename Alloc>
+void AllocatedFrame<Promise>::Deallocate(void* frame, std::size_t size) {
+  Alloc* stored = At<Alloc>(frame, AllocatorOffset<Alloc>(size));
+  Alloc alloc(std::move(*stored));
+  stored->~Alloc();
+  std::allocator_traits<Alloc>::deallocate(alloc, static_cast<Block*>(frame),
+                                           BlockCount<Alloc>(size));
+}
+
+}  // namespace frame_allocator
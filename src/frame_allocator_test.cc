@@ -0,0 +1,132 @@
+#include "diy/coro/frame_allocator.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "diy/coro/async_generator.h"
+#include "diy/coro/container_generator.h"
+#include "diy/coro/generator.h"
+#include "diy/coro/task.h"
+
+using testing::ElementsAre;
+
+namespace {
+
+struct AllocationCounts {
+  int allocations = 0;
+  int deallocations = 0;
+  std::size_t live_bytes = 0;
+};
+
+// Stateful allocator that counts into a shared AllocationCounts.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(AllocationCounts& counts) : counts(&counts) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other) : counts(other.counts) {}
+
+  T* allocate(std::size_t n) {
+    ++counts->allocations;
+    counts->live_bytes += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) {
+    ++counts->deallocations;
+    counts->live_bytes -= n * sizeof(T);
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  bool operator==(const CountingAllocator&) const = default;
+
+  AllocationCounts* counts;
+};
+
+Task<int> Add(std::allocator_arg_t, CountingAllocator<std::byte>, int a,
+              int b) {
+  co_return a + b;
+}
+
+}  // namespace
+
+TEST(FrameAllocatorTest, Task) {
+  AllocationCounts counts;
+  {
+    Task<int> task =
+        Add(std::allocator_arg, CountingAllocator<std::byte>(counts), 1, 2);
+    EXPECT_EQ(counts.allocations, 1);
+    EXPECT_GT(counts.live_bytes, 0);
+    EXPECT_EQ(std::move(task).Wait(), 3);
+  }
+  EXPECT_EQ(counts.deallocations, 1);
+  EXPECT_EQ(counts.live_bytes, 0);
+}
+
+TEST(FrameAllocatorTest, Lambda) {
+  AllocationCounts counts;
+  {
+    auto gen = [](std::allocator_arg_t, auto) -> Generator<int> {
+      co_yield 1;
+      co_yield 2;
+    }(std::allocator_arg, CountingAllocator<int>(counts));
+    EXPECT_EQ(counts.allocations, 1);
+    EXPECT_EQ(gen(), 1);
+    EXPECT_EQ(gen(), 2);
+  }
+  EXPECT_EQ(counts.deallocations, 1);
+  EXPECT_EQ(counts.live_bytes, 0);
+}
+
+TEST(FrameAllocatorTest, AsyncGenerator) {
+  AllocationCounts counts;
+  {
+    auto gen = [](std::allocator_arg_t, auto) -> AsyncGenerator<int> {
+      co_yield 1;
+      co_yield 2;
+    }(std::allocator_arg, CountingAllocator<std::byte>(counts));
+    EXPECT_EQ(counts.allocations, 1);
+    EXPECT_THAT(gen.ToVector(), ElementsAre(1, 2));
+  }
+  EXPECT_EQ(counts.live_bytes, 0);
+}
+
+TEST(FrameAllocatorTest, VectorGenerator) {
+  AllocationCounts counts;
+  std::vector<int> values =
+      [](std::allocator_arg_t, auto) -> VectorGenerator<int> {
+    co_yield 1;
+    co_yield 2;
+  }(std::allocator_arg, CountingAllocator<std::byte>(counts));
+  EXPECT_THAT(values, ElementsAre(1, 2));
+  EXPECT_EQ(counts.allocations, 1);
+  EXPECT_EQ(counts.live_bytes, 0);
+}
+
+TEST(FrameAllocatorTest, PolymorphicAllocator) {
+  alignas(std::max_align_t) std::array<std::byte, 4096> buffer;
+  // Fails any allocation that doesn't fit in `buffer`.
+  std::pmr::monotonic_buffer_resource resource(
+      buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+  std::pmr::polymorphic_allocator<> alloc(&resource);
+
+  auto task = [](std::allocator_arg_t, auto alloc) -> Task<int> {
+    int sum = 0;
+    auto gen = [](std::allocator_arg_t, auto) -> Generator<int> {
+      co_yield 1;
+      co_yield 2;
+    }(std::allocator_arg, alloc);
+    for (int value : gen) {
+      sum += value;
+    }
+    co_return sum;
+  }(std::allocator_arg, alloc);
+  EXPECT_EQ(std::move(task).Wait(), 3);
+}
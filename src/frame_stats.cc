@@ -0,0 +1,151 @@
+#include "diy/coro/frame_stats.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/hash/hash.h>
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <tuple>
+
+namespace frame_stats {
+
+struct Site {
+  const std::type_info* promise_type;
+  std::source_location location;
+
+  std::atomic_int64_t live_frames = 0;
+  std::atomic_int64_t live_bytes = 0;
+  std::atomic_int64_t peak_live_bytes = 0;
+  std::atomic_uint64_t allocations = 0;
+  std::atomic_uint64_t allocated_bytes = 0;
+};
+
+namespace {
+
+// Keeps frames aligned to what the global operator new would provide.
+constexpr std::size_t kHeaderSize = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+static_assert(kHeaderSize >= sizeof(Site*));
+
+using SiteKey = std::tuple<const std::type_info*, const char*, const char*,
+                           std::uint32_t, std::uint32_t>;
+
+struct Registry {
+  std::mutex mutex;
+  absl::flat_hash_map<SiteKey, std::unique_ptr<Site>> sites;
+};
+
+// Per-thread memo of recently used sites, so that the registry lock is only
+// taken the first time a thread allocates at a call site. Direct-mapped; on a
+// collision the older entry is evicted.
+struct CachedSite {
+  SiteKey key;
+  Site* site = nullptr;
+};
+
+constexpr std::size_t kCachedSites = 64;
+
+thread_local std::array<CachedSite, kCachedSites> site_cache;
+
+Registry& GetRegistry() {
+  // Leaked, as frames may be freed during static destruction.
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+std::string Demangle(const char* name) {
+  int status = 0;
+  std::unique_ptr<char, decltype(&std::free)> demangled(
+      abi::__cxa_demangle(name, nullptr, nullptr, &status), &std::free);
+  return status == 0 ? std::string(demangled.get()) : std::string(name);
+}
+
+}  // namespace
+
+Site& GetSite(const std::type_info& promise_type,
+              const std::source_location& location) {
+  const SiteKey key{&promise_type, location.file_name(),
+                    location.function_name(), location.line(),
+                    location.column()};
+  CachedSite& cached = site_cache[absl::HashOf(key) % kCachedSites];
+  if (cached.site != nullptr && cached.key == key) {
+    return *cached.site;
+  }
+
+  Registry& registry = GetRegistry();
+  auto lock = std::lock_guard(registry.mutex);
+  std::unique_ptr<Site>& site = registry.sites[key];
+  if (site == nullptr) {
+    site = std::make_unique<Site>();
+    site->promise_type = &promise_type;
+    site->location = location;
+  }
+  cached = {.key = key, .site = site.get()};
+  return *site;
+}
+
+void* Allocate(std::size_t size, Site& site) {
+  auto* block = static_cast<std::byte*>(::operator new(size + kHeaderSize));
+  *reinterpret_cast<Site**>(block) = &site;
+
+  site.allocations.fetch_add(1, std::memory_order::relaxed);
+  site.allocated_bytes.fetch_add(size, std::memory_order::relaxed);
+  site.live_frames.fetch_add(1, std::memory_order::relaxed);
+  const std::int64_t live =
+      site.live_bytes.fetch_add(size, std::memory_order::relaxed) + size;
+  std::int64_t peak = site.peak_live_bytes.load(std::memory_order::relaxed);
+  while (live > peak && !site.peak_live_bytes.compare_exchange_weak(
+                            peak, live, std::memory_order::relaxed)) {
+  }
+  return block + kHeaderSize;
+}
+
+void Deallocate(void* frame, std::size_t size) {
+  std::byte* block = static_cast<std::byte*>(frame) - kHeaderSize;
+  Site& site = **reinterpret_cast<Site**>(block);
+  site.live_frames.fetch_sub(1, std::memory_order::relaxed);
+  site.live_bytes.fetch_sub(size, std::memory_order::relaxed);
+  ::operator delete(block, size + kHeaderSize);
+}
+
+std::vector<SiteStats> Snapshot() {
+  Registry& registry = GetRegistry();
+  auto lock = std::lock_guard(registry.mutex);
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<SiteStats> stats;
+  stats.reserve(registry.sites.size());
+  for (const auto& [key, site] : registry.sites) {
+    stats.push_back({
+        .promise_type = Demangle(site->promise_type->name()),
+        .function = site->location.function_name(),
+        .file = site->location.file_name(),
+        .line = site->location.line(),
+        .live_frames = site->live_frames.load(std::memory_order::relaxed),
+        .live_bytes = site->live_bytes.load(std::memory_order::relaxed),
+        .peak_live_bytes =
+            site->peak_live_bytes.load(std::memory_order::relaxed),
+        .allocations = site->allocations.load(std::memory_order::relaxed),
+        .allocated_bytes =
+            site->allocated_bytes.load(std::memory_order::relaxed),
+        .time = now,
+    });
+  }
+  std::sort(stats.begin(), stats.end(), [](const auto& a, const auto& b) {
+    return a.live_bytes > b.live_bytes;
+  });
+  return stats;
+}
+
+double AllocationsPerSecond(const SiteStats& earlier, const SiteStats& later) {
+  const double elapsed =
+      std::chrono::duration<double>(later.time - earlier.time).count();
+  return elapsed > 0 ? (later.allocations - earlier.allocations) / elapsed : 0;
+}
+
+}  // namespace frame_stats
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <source_location>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+// Coroutine frame allocation statistics. Enabled by building with
+// DIY_CORO_FRAME_STATS defined (see the DIY_ENABLE_FRAME_STATS CMake option);
+// otherwise frames are allocated with the global operator new as usual.
+//
+// Frames are attributed to the promise type and the coroutine function that
+// allocated them, so that oversized frames and coroutines that are never
+// destroyed can be traced back to their source.
+namespace frame_stats {
+
+#ifdef DIY_CORO_FRAME_STATS
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+
+struct SiteStats {
+  // Demangled name of the promise type.
+  std::string promise_type;
+  // The coroutine function.
+  std::string function;
+  std::string file;
+  std::uint32_t line;
+
+  // Frames allocated but not yet freed.
+  std::int64_t live_frames;
+  std::int64_t live_bytes;
+  // Largest value of `live_bytes` so far.
+  std::int64_t peak_live_bytes;
+  // Totals since the first allocation.
+  std::uint64_t allocations;
+  std::uint64_t allocated_bytes;
+
+  // When the statistics were taken.
+  std::chrono::steady_clock::time_point time;
+};
+
+// Statistics for every call site that has allocated a frame so far, with the
+// most live bytes first. Has no side effects, so any number of readers may
+// take snapshots independently.
+std::vector<SiteStats> Snapshot();
+
+// Average allocations per second at a call site between two of its
+// snapshots; typically the previous and latest ones taken by the same reader.
+double AllocationsPerSecond(const SiteStats& earlier, const SiteStats& later);
+
+// Counters for a single (promise type, coroutine function) pair.
+struct Site;
+
+// Finds or creates the entry for the given key. Sites live forever.
+Site& GetSite(const std::type_info& promise_type,
+              const std::source_location& location);
+
+// Allocate and free frames attributed to `site`. The site is stored in a
+// small header in front of the frame, so Deallocate() only needs the frame.
+void* Allocate(std::size_t size, Site& site);
+void Deallocate(void* frame, std::size_t size);
+
+// Base class for promise types. If enabled, provides promise-specific
+// operator new and delete that record into the registry.
+template <typename Promise, bool Enabled = kEnabled>
+struct TrackedFrame {};
+
+template <typename Promise>
+struct TrackedFrame<Promise, true> {
+  // When no other overload matches the coroutine's arguments, the compiler
+  // calls this with just the frame size, so `location` is the default
+  // argument; evaluated in the context of the coroutine function.
+  static void* operator new(
+      std::size_t size,
+      std::source_location location = std::source_location::current()) {
+    return Allocate(size, GetSite(typeid(Promise), location));
+  }
+
+  static void operator delete(void* frame, std::size_t size) {
+    Deallocate(frame, size);
+  }
+};
+
+}  // namespace frame_stats
@@ -0,0 +1,147 @@
+#include "diy/coro/frame_stats.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "diy/coro/task.h"
+
+using testing::HasSubstr;
+
+namespace {
+
+// Minimal lazily-started coroutine that is always tracked.
+struct Tracked {
+  struct promise_type : frame_stats::TrackedFrame<promise_type, true> {
+    Tracked get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+Tracked SmallFrame() { co_return; }
+
+Tracked LargeFrame(int index) {
+  std::array<char, 1024> buffer;
+  buffer.fill(1);
+  co_await std::suspend_always();
+  // Keeps `buffer` alive across the suspension.
+  volatile char value = buffer[index];
+  static_cast<void>(value);
+}
+
+std::optional<frame_stats::SiteStats> FindSite(const std::string& function) {
+  for (frame_stats::SiteStats& stats : frame_stats::Snapshot()) {
+    if (stats.function.find(function) != std::string::npos) {
+      return stats;
+    }
+  }
+  return std::nullopt;
+}
+
+}  // namespace
+
+TEST(FrameStatsTest, TracksLiveFrames) {
+  Tracked a = SmallFrame();
+  Tracked b = SmallFrame();
+
+  std::optional<frame_stats::SiteStats> stats = FindSite("SmallFrame");
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_THAT(stats->promise_type, HasSubstr("Tracked::promise_type"));
+  EXPECT_THAT(stats->file, HasSubstr("frame_stats_test.cc"));
+  EXPECT_EQ(stats->live_frames, 2);
+  EXPECT_GT(stats->live_bytes, 0);
+  const std::int64_t frame_size = stats->live_bytes / 2;
+
+  a.handle.destroy();
+  stats = FindSite("SmallFrame");
+  EXPECT_EQ(stats->live_frames, 1);
+  EXPECT_EQ(stats->live_bytes, frame_size);
+  EXPECT_EQ(stats->peak_live_bytes, 2 * frame_size);
+
+  b.handle.destroy();
+  stats = FindSite("SmallFrame");
+  EXPECT_EQ(stats->live_frames, 0);
+  EXPECT_EQ(stats->live_bytes, 0);
+  EXPECT_GE(stats->allocations, 2);
+  EXPECT_GE(stats->allocated_bytes, 2 * frame_size);
+}
+
+TEST(FrameStatsTest, SeparatesCallSites) {
+  Tracked small = SmallFrame();
+  Tracked large = LargeFrame(0);
+
+  EXPECT_GT(FindSite("LargeFrame")->live_bytes,
+            FindSite("SmallFrame")->live_bytes + 1000);
+
+  small.handle.destroy();
+  large.handle.destroy();
+}
+
+TEST(FrameStatsTest, AllocationRateBetweenSnapshots) {
+  SmallFrame().handle.destroy();
+  const frame_stats::SiteStats earlier = *FindSite("SmallFrame");
+  for (int i = 0; i < 10; ++i) {
+    SmallFrame().handle.destroy();
+  }
+  // Another reader's snapshot doesn't affect ours.
+  FindSite("SmallFrame");
+  const frame_stats::SiteStats later = *FindSite("SmallFrame");
+
+  EXPECT_EQ(later.allocations - earlier.allocations, 10);
+  ASSERT_GT(later.time, earlier.time);
+  const double seconds =
+      std::chrono::duration<double>(later.time - earlier.time).count();
+  EXPECT_DOUBLE_EQ(frame_stats::AllocationsPerSecond(earlier, later),
+                   10 / seconds);
+}
+
+TEST(FrameStatsTest, SharesSitesAcrossThreads) {
+  std::optional<frame_stats::SiteStats> stats = FindSite("SmallFrame");
+  const std::uint64_t allocations = stats ? stats->allocations : 0;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([] {
+      for (int j = 0; j < 100; ++j) {
+        SmallFrame().handle.destroy();
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  stats = FindSite("SmallFrame");
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->allocations, allocations + 400);
+  EXPECT_EQ(stats->live_frames, 0);
+}
+
+TEST(FrameStatsTest, TracksTasks) {
+  if (!frame_stats::kEnabled) {
+    GTEST_SKIP() << "Built without DIY_CORO_FRAME_STATS";
+  }
+  auto task = []() -> Task<int> { co_return 1; };
+  EXPECT_EQ(task().Wait(), 1);
+
+  const std::vector<frame_stats::SiteStats> snapshot = frame_stats::Snapshot();
+  EXPECT_TRUE(std::any_of(snapshot.begin(), snapshot.end(), [](auto& stats) {
+    return stats.promise_type.starts_with("Task<int>::Promise") &&
+           stats.allocations > 0 && stats.live_frames == 0;
+  }));
+}
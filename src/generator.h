@@ -6,16 +6,41 @@
 #include <coroutine>
 #include <exception>
 #include <iterator>
-#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#include "diy/coro/frame_allocator.h"
+#include "diy/coro/handle.h"
+#include "diy/coro/trace.h"
+
+// Wrapper for yielding every element of `range` from a Generator, as if each
+// element were yielded individually:
+//
+//   co_yield ElementsOf(Children(node));
+//
+// If `range` is itself a Generator of the same type, it is resumed directly
+// by the consumer for each element rather than through each enclosing
+// generator, so recursive generators produce each element in constant time
+// regardless of depth. Like std::ranges::elements_of, only holds a reference
+// to `range`, which must outlive the co_yield expression. A Generator passed
+// as an lvalue may be consumed further after the co_yield, even if the
+// enclosing generator was destroyed part way through it.
+template <std::ranges::range R>
+struct ElementsOf {
+  R range;
+};
+
+template <typename R>
+ElementsOf(R&&) -> ElementsOf<R&&>;
 
 // Coroutine for synchronously yielding a stream of values of tyoe
 // T. Concurrent calls to any method or iterator methods is undefined
-// behavior.
+// behavior. Owns the coroutine; iterators must not outlive the Generator.
 template <typename T>
 class Generator {
   struct Promise;
   using Handle = std::coroutine_handle<Promise>;
-  struct HandleCleanup;
   struct Iterator;
 
  public:
@@ -23,23 +48,29 @@ class Generator {
   using value_type = T;
 
   Generator() = default;
-  Generator(Handle handle)
-      : shared_handle_(std::make_shared<HandleCleanup>(handle)),
-        iter_{handle} {}
+
+  // Moveable.
+  Generator(Generator&&) = default;
+  Generator& operator=(Generator&&) = default;
 
   // Produces the next value of the sequence.
-  T& operator()() { return *++iter_; }
+  T& operator()() { return *++Iterator{coroutine()}; }
 
   // Allows for iteration over the stream of values. Equality
   // comparison between iterators is only meaningful against end().
   // If begin() has already been called, the next call will correspond
   // to the next value of the sequence, not the original first value.
-  std::input_iterator auto begin() const { return ++iter_; }
+  std::input_iterator auto begin() const { return ++Iterator{coroutine()}; }
   std::input_iterator auto end() const { return Iterator{}; }
 
  private:
-  std::shared_ptr<HandleCleanup> shared_handle_;
-  mutable Iterator iter_;
+  Generator(Handle handle) : handle_(handle) {}
+
+  Handle coroutine() const {
+    return Handle::from_promise(handle_.template promise<Promise>());
+  }
+
+  ::Handle handle_;
 };
 
 // Allow direct use as a view in std::ranges library.
@@ -47,31 +78,83 @@ template <typename T>
 inline constexpr bool std::ranges::enable_view<Generator<T>> = true;
 
 template <typename T>
-struct Generator<T>::Promise {
+struct Generator<T>::Promise : frame_allocator::AllocatedFrame<Promise> {
   // Previously yielded value. Is nullptr before the first co_yield, and after
   // the final co_yield. Otherwise this value is only meaningful if we are
-  // currently suspended inside a co_yield statement.
+  // currently suspended inside a co_yield statement. Values yielded by nested
+  // generators are stored in the root's promise.
   T* value = nullptr;
 
   // Exception thrown by couroutine, if any.
   std::exception_ptr exception;
 
+  // Generators nested with ElementsOf() form a stack. `root` is the bottom of
+  // the stack (`this` if not nested), and `parent` is the generator that
+  // yielded this one's elements (nullptr if not nested). Only meaningful in
+  // the root, `leaf` is the top of the stack; the generator to resume for the
+  // next value.
+  Promise* root = this;
+  Promise* parent = nullptr;
+  Promise* leaf = this;
+  // Generator whose elements we are currently yielding, if any, and the same
+  // generator if it was passed to ElementsOf() as an rvalue.
+  Handle nested;
+  Generator<T> owned_nested;
+
+  [[no_unique_address]] trace::FrameTracer tracer{"Generator"};
+
+  // If destroyed while yielding the elements of a generator passed to
+  // ElementsOf() as an lvalue, hands that generator back its own stack so
+  // that its owner can keep consuming it.
+  ~Promise() {
+    if (!nested || owned_nested.handle_.get()) {
+      return;
+    }
+    Promise& child = nested.promise();
+    Promise* leaf = root->leaf;
+    for (Promise* p = leaf; p != &child; p = p->parent) {
+      p->root = &child;
+    }
+    child.root = &child;
+    child.parent = nullptr;
+    child.leaf = leaf;
+  }
+
   Generator<T> get_return_object() {
     return Generator<T>(Handle::from_promise(*this));
   }
 
-  std::suspend_always initial_suspend() { return {}; }
-  std::suspend_always final_suspend() noexcept {
-    value = nullptr;
-    return {};
+  auto initial_suspend() {
+    return trace::Traced(std::suspend_always(), tracer);
+  }
+  auto final_suspend() noexcept {
+    struct Awaiter : std::suspend_always {
+      Promise& promise;
+
+      // A nested generator hands control straight back to its parent, which
+      // continues from its co_yield ElementsOf(...) statement.
+      std::coroutine_handle<> await_suspend(Handle) noexcept {
+        Promise* parent = promise.parent;
+        if (parent == nullptr) {
+          return std::noop_coroutine();
+        }
+        promise.root->leaf = parent;
+        return Handle::from_promise(*parent);
+      }
+    };
+    if (parent == nullptr) {
+      value = nullptr;
+    }
+    tracer.Complete();
+    return Awaiter{.promise = *this};
   }
   void unhandled_exception() { exception = std::current_exception(); }
 
   // Resume execution of the parent to notify it that a new value is available,
   // and then wait for the parent to request a new value.
-  std::suspend_always yield_value(T& new_value) {
-    value = &new_value;
-    return {};
+  auto yield_value(T& new_value) {
+    root->value = &new_value;
+    return trace::Traced(std::suspend_always(), tracer);
   }
 
   // Note: Even though this overload directly matches against T&&, it will also
@@ -79,9 +162,31 @@ struct Generator<T>::Promise {
   // Any T&& temporaries created as a result of implicit conversion are created
   // by the calling coroutine and will be kept alive across the suspension
   // point.
-  std::suspend_always yield_value(T&& new_value) {
-    value = &new_value;
-    return {};
+  auto yield_value(T&& new_value) {
+    root->value = &new_value;
+    return trace::Traced(std::suspend_always(), tracer);
+  }
+
+  // Pushes a Generator onto the stack until it is exhausted, or rethrows its
+  // exception. Other ranges are first wrapped in a Generator.
+  template <typename R>
+  auto yield_value(ElementsOf<R> elements) {
+    if constexpr (std::is_same_v<std::remove_cvref_t<R>, Generator<T>>) {
+      if constexpr (!std::is_lvalue_reference_v<R>) {
+        owned_nested = std::move(elements.range);
+        nested = owned_nested.coroutine();
+      } else {
+        nested = elements.range.coroutine();
+      }
+      return trace::Traced(NestedAwaiter{.parent = *this}, tracer);
+    } else {
+      return yield_value(ElementsOf{
+          [](R range) -> Generator<T> {
+            for (auto&& element : range) {
+              co_yield static_cast<decltype(element)>(element);
+            }
+          }(std::forward<R>(elements.range))});
+    }
   }
 
   void return_void() {}
@@ -90,6 +195,40 @@ struct Generator<T>::Promise {
   // synchronous.
   template <typename A>
   auto await_transform(A&&) = delete;
+
+  struct NestedAwaiter;
+};
+
+template <typename T>
+struct Generator<T>::Promise::NestedAwaiter {
+  Promise& parent;
+
+  Promise& child_promise() const { return parent.nested.promise(); }
+
+  bool await_ready() const { return parent.nested.done(); }
+
+  Handle await_suspend(Handle) {
+    Promise& promise = child_promise();
+    Promise& root = *parent.root;
+    // The child may already have its own stack of nested generators if it
+    // was partially consumed before being passed to us; re-root all of them.
+    for (Promise* p = promise.leaf; p != &promise; p = p->parent) {
+      p->root = &root;
+    }
+    root.leaf = promise.leaf;
+    promise.root = &root;
+    promise.parent = &parent;
+    return Handle::from_promise(*root.leaf);
+  }
+
+  void await_resume() const {
+    std::exception_ptr exception = std::move(child_promise().exception);
+    parent.nested = nullptr;
+    parent.owned_nested = {};
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
 };
 
 // Models an input iterator.
@@ -109,7 +248,7 @@ struct Generator<T>::Iterator {
   T* operator->() const { return handle.promise().value; }
 
   Iterator& operator++() {
-    handle.resume();
+    Handle::from_promise(*handle.promise().leaf).resume();
     if (handle.promise().exception) {
       std::rethrow_exception(handle.promise().exception);
     }
@@ -130,16 +269,3 @@ struct Generator<T>::Iterator {
   // that's okay since only comparison to end() is needed.
   bool operator==(Iterator) const { return handle.promise().value == nullptr; }
 };
-
-// Destroys the coroutine handle on destruction. This is not a true
-// RAII type (copies and moves would cause multiple destruction), but
-// this is only used in a private shared-ptr, where only one instance
-// of this struct is instantiated per handle.
-template <typename T>
-struct Generator<T>::HandleCleanup {
-  Handle handle;
-
-  // Explicit constructor needed for std::make_shared
-  HandleCleanup(Handle handle) : handle(handle) {}
-  ~HandleCleanup() { handle.destroy(); }
-};
@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include "diy/coro/generator.h"
+
+namespace {
+Generator<int> Iota(int n) {
+  for (int i = 0; i < n; ++i) {
+    co_yield i;
+  }
+}
+
+// Yields 0..n-1 from beneath `depth` levels of generators.
+Generator<int> Nested(int depth, int n) {
+  if (depth > 1) {
+    co_yield ElementsOf(Nested(depth - 1, n));
+    co_return;
+  }
+  for (int i = 0; i < n; ++i) {
+    co_yield i;
+  }
+}
+
+constexpr int kElements = 1'000;
+}  // namespace
+
+static void BM_LoopRoutine(benchmark::State& state) {
+  for (auto _ : state) {
+    for (int i = 0; i < kElements; ++i) {
+      benchmark::DoNotOptimize(i);
+    }
+  }
+  state.SetItemsProcessed(kElements * state.iterations());
+}
+
+static void BM_GeneratorCoroutine(benchmark::State& state) {
+  for (auto _ : state) {
+    for (int i : Iota(kElements)) {
+      benchmark::DoNotOptimize(i);
+    }
+  }
+  state.SetItemsProcessed(kElements * state.iterations());
+}
+
+// Cost per element should not depend on the depth.
+static void BM_NestedGenerator(benchmark::State& state) {
+  const int depth = state.range(0);
+  for (auto _ : state) {
+    for (int value : Nested(depth, kElements)) {
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  state.SetItemsProcessed(kElements * state.iterations());
+}
+
+BENCHMARK(BM_LoopRoutine);
+BENCHMARK(BM_GeneratorCoroutine);
+BENCHMARK(BM_NestedGenerator)->Arg(1)->Arg(8)->Arg(64);
@@ -6,6 +6,8 @@
 #include <algorithm>
 #include <iterator>
 #include <ranges>
+#include <stdexcept>
+#include <vector>
 
 using testing::ElementsAre;
 
@@ -33,6 +35,21 @@ TEST(GeneratorTest, ExceptionProagated) {
   EXPECT_THROW(gen(), std::runtime_error);
 }
 
+TEST(GeneratorTest, MoveOnly) {
+  static_assert(!std::copy_constructible<Generator<int>>);
+
+  auto gen = []() -> Generator<int> {
+    co_yield 0;
+    co_yield 1;
+  }();
+
+  EXPECT_EQ(gen(), 0);
+  Generator<int> moved = std::move(gen);
+  EXPECT_EQ(moved(), 1);
+  moved = []() -> Generator<int> { co_yield 2; }();
+  EXPECT_EQ(moved(), 2);
+}
+
 template <std::ranges::range R>
 auto ToVector(R&& gen) {
   using T = std::ranges::range_value_t<R>;
@@ -56,3 +73,105 @@ TEST(IteratorTest, Iota) {
 
   // EXPECT_THAT(ToVector(gen | std::views::take(3)), ElementsAre(0, 1, 2));
 }
+
+// Yields the values of a complete binary tree of the given depth in preorder,
+// numbering nodes as in a binary heap.
+Generator<int> Preorder(int node, int depth) {
+  co_yield node;
+  if (depth > 1) {
+    co_yield ElementsOf(Preorder(2 * node, depth - 1));
+    co_yield ElementsOf(Preorder(2 * node + 1, depth - 1));
+  }
+}
+
+TEST(ElementsOfTest, Recursive) {
+  EXPECT_THAT(ToVector(Preorder(1, 3)), ElementsAre(1, 2, 4, 5, 3, 6, 7));
+}
+
+TEST(ElementsOfTest, DeepRecursion) {
+  constexpr int kDepth = 1'000;
+  auto countdown = [](auto& self, int n) -> Generator<int> {
+    if (n > 0) {
+      co_yield ElementsOf(self(self, n - 1));
+      co_yield n;
+    }
+  };
+  auto gen = countdown(countdown, kDepth);
+  int expected = 1;
+  for (int value : gen) {
+    ASSERT_EQ(value, expected++);
+  }
+  EXPECT_EQ(expected, kDepth + 1);
+}
+
+TEST(ElementsOfTest, OtherRanges) {
+  auto gen = []() -> Generator<int> {
+    co_yield 0;
+    std::vector<int> values = {1, 2};
+    co_yield ElementsOf(std::move(values));
+    std::vector<int> lvalue = {3, 4};
+    co_yield ElementsOf(lvalue);
+    co_yield ElementsOf(std::views::iota(5, 7));
+  }();
+
+  EXPECT_THAT(ToVector(gen), ElementsAre(0, 1, 2, 3, 4, 5, 6));
+}
+
+TEST(ElementsOfTest, PartiallyConsumed) {
+  auto child = Preorder(1, 2);
+  EXPECT_EQ(child(), 1);
+  auto gen = [](Generator<int>& child) -> Generator<int> {
+    co_yield ElementsOf(child);
+    co_yield 0;
+  }(child);
+
+  EXPECT_THAT(ToVector(gen), ElementsAre(2, 3, 0));
+}
+
+TEST(ElementsOfTest, ParentDestroyedPartWayThroughBorrowedChild) {
+  // Abandoned while the child is itself yielding a nested generator.
+  auto child = Preorder(1, 3);
+  {
+    auto gen = [](Generator<int>& child) -> Generator<int> {
+      co_yield ElementsOf(child);
+      co_yield 0;
+    }(child);
+    EXPECT_EQ(gen(), 1);
+    EXPECT_EQ(gen(), 2);
+  }
+
+  EXPECT_THAT(ToVector(child), ElementsAre(4, 5, 3, 6, 7));
+}
+
+TEST(ElementsOfTest, ExceptionPropagated) {
+  auto throwing = []() -> Generator<int> {
+    co_yield 1;
+    throw std::runtime_error("fake exception");
+  };
+  auto gen = [&]() -> Generator<int> {
+    co_yield ElementsOf(throwing());
+    co_yield 2;
+  }();
+
+  EXPECT_EQ(gen(), 1);
+  EXPECT_THROW(gen(), std::runtime_error);
+}
+
+TEST(ElementsOfTest, ExceptionCaughtByParent) {
+  auto throwing = []() -> Generator<int> {
+    co_yield 1;
+    throw std::runtime_error("fake exception");
+  };
+  auto gen = [&]() -> Generator<int> {
+    bool caught = false;
+    try {
+      co_yield ElementsOf(throwing());
+    } catch (const std::runtime_error&) {
+      caught = true;
+    }
+    co_yield caught ? -1 : 0;
+    co_yield 2;
+  }();
+
+  EXPECT_THAT(ToVector(gen), ElementsAre(1, -1, 2));
+}
@@ -10,8 +10,9 @@ class Handle {
   explicit Handle(std::coroutine_handle<> handle) : handle_(handle) {}
   Handle(Handle&& other) noexcept { *this = std::move(other); }
 
+  // Swaps, so that `other` destroys any coroutine we previously owned.
   Handle& operator=(Handle&& other) noexcept {
-    handle_ = std::exchange(other.handle_, nullptr);
+    std::swap(handle_, other.handle_);
     return *this;
   }
 
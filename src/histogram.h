@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+// Histogram of non-negative integer samples with log-linear buckets: each
+// power of two is split into kSubBuckets equal-width buckets, so any recorded
+// value is known to within 1/kSubBuckets of its true value, over the entire
+// 64-bit range, in a fixed 4KiB of counters.
+//
+// Record() is wait-free but must only be called from one thread at a time.
+// TakeSnapshot() may be called concurrently from any thread.
+class Histogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr std::uint64_t kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  class Snapshot;
+
+  void Record(std::uint64_t value);
+
+  Snapshot TakeSnapshot() const;
+
+  // The bucket that `value` is counted in.
+  static constexpr int BucketIndex(std::uint64_t value);
+  // The smallest value counted in bucket `index`.
+  static constexpr std::uint64_t BucketLowerBound(int index);
+
+ private:
+  // Single-writer increment; cheaper than fetch_add.
+  static void Increment(std::atomic_uint64_t& counter, std::uint64_t delta) {
+    counter.store(counter.load(std::memory_order::relaxed) + delta,
+                  std::memory_order::relaxed);
+  }
+
+  std::array<std::atomic_uint64_t, kBucketCount> buckets_ = {};
+  std::atomic_uint64_t sum_ = 0;
+  std::atomic_uint64_t max_ = 0;
+};
+
+class Histogram::Snapshot {
+ public:
+  std::uint64_t count() const { return count_; }
+  std::uint64_t sum() const { return sum_; }
+  std::uint64_t max() const { return max_; }
+  double Mean() const {
+    return count_ == 0 ? 0 : static_cast<double>(sum_) / count_;
+  }
+
+  // Lower bound of the bucket containing the `p`th quantile (0 <= p <= 1), or
+  // 0 if there are no samples.
+  std::uint64_t Percentile(double p) const;
+
+  // Combines samples from both snapshots, or removes the samples of an earlier
+  // snapshot of the same histogram.
+  Snapshot& operator+=(const Snapshot& other);
+  Snapshot& operator-=(const Snapshot& other);
+
+  const std::array<std::uint64_t, kBucketCount>& buckets() const {
+    return buckets_;
+  }
+
+ private:
+  friend class Histogram;
+
+  std::array<std::uint64_t, kBucketCount> buckets_ = {};
+  std::uint64_t count_ = 0;
+  std::uint64_t sum_ = 0;
+  std::uint64_t max_ = 0;
+};
+
+////////////////////
+// Implementation //
+////////////////////
+
+constexpr int Histogram::BucketIndex(std::uint64_t value) {
+  if (value < kSubBuckets) {
+    return static_cast<int>(value);
+  }
+  // Position of the highest set bit, relative to the sub-bucket bits.
+  const int shift = std::bit_width(value) - 1 - kSubBucketBits;
+  return static_cast<int>((shift + 1) * kSubBuckets +
+                          ((value >> shift) - kSubBuckets));
+}
+
+constexpr std::uint64_t Histogram::BucketLowerBound(int index) {
+  if (index < static_cast<int>(kSubBuckets)) {
+    return index;
+  }
+  const int shift = index / kSubBuckets - 1;
+  return (kSubBuckets + index % kSubBuckets) << shift;
+}
+
+inline void Histogram::Record(std::uint64_t value) {
+  Increment(buckets_[BucketIndex(value)], 1);
+  Increment(sum_, value);
+  if (value > max_.load(std::memory_order::relaxed)) {
+    max_.store(value, std::memory_order::relaxed);
+  }
+}
+
+inline auto Histogram::TakeSnapshot() const -> Snapshot {
+  Snapshot snapshot;
+  for (int i = 0; i < kBucketCount; ++i) {
+    snapshot.buckets_[i] = buckets_[i].load(std::memory_order::relaxed);
+    snapshot.count_ += snapshot.buckets_[i];
+  }
+  // Derive the count from the buckets so that percentiles are consistent
+  // even if samples were recorded while we were reading.
+  snapshot.sum_ = sum_.load(std::memory_order::relaxed);
+  snapshot.max_ = max_.load(std::memory_order::relaxed);
+  return snapshot;
+}
+
+inline std::uint64_t Histogram::Snapshot::Percentile(double p) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const auto rank = static_cast<std::uint64_t>(
+      std::clamp(p, 0.0, 1.0) * static_cast<double>(count_ - 1));
+  std::uint64_t seen = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += buckets_[i];
+    if (seen > rank) {
+      return BucketLowerBound(i);
+    }
+  }
+  return max_;
+}
+
+inline auto Histogram::Snapshot::operator+=(const Snapshot& other)
+    -> Snapshot& {
+  for (int i = 0; i < kBucketCount; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+  return *this;
+}
+
+inline auto Histogram::Snapshot::operator-=(const Snapshot& other)
+    -> Snapshot& {
+  for (int i = 0; i < kBucketCount; ++i) {
+    buckets_[i] -= other.buckets_[i];
+  }
+  count_ -= other.count_;
+  sum_ -= other.sum_;
+  // The maximum can't be un-merged; keep the overall one.
+  return *this;
+}
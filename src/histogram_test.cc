@@ -0,0 +1,72 @@
+#include "diy/coro/histogram.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+
+TEST(HistogramTest, SmallValuesHaveExactBuckets) {
+  for (std::uint64_t i = 0; i < 2 * Histogram::kSubBuckets; ++i) {
+    EXPECT_EQ(Histogram::BucketLowerBound(Histogram::BucketIndex(i)), i);
+  }
+}
+
+TEST(HistogramTest, BucketsAreContiguous) {
+  for (int i = 1; i < Histogram::kBucketCount; ++i) {
+    const std::uint64_t lower = Histogram::BucketLowerBound(i);
+    EXPECT_EQ(Histogram::BucketIndex(lower), i);
+    EXPECT_EQ(Histogram::BucketIndex(lower - 1), i - 1);
+  }
+  EXPECT_EQ(Histogram::BucketIndex(std::numeric_limits<std::uint64_t>::max()),
+            Histogram::kBucketCount - 1);
+}
+
+TEST(HistogramTest, RelativeErrorIsBounded) {
+  for (std::uint64_t value = 1; value < (1ull << 40); value = value * 3 + 1) {
+    const std::uint64_t lower =
+        Histogram::BucketLowerBound(Histogram::BucketIndex(value));
+    EXPECT_LE(lower, value);
+    EXPECT_LE(value - lower, value / Histogram::kSubBuckets);
+  }
+}
+
+TEST(HistogramTest, Percentiles) {
+  Histogram histogram;
+  for (std::uint64_t i = 1; i <= 100; ++i) {
+    histogram.Record(i);
+  }
+  const Histogram::Snapshot snapshot = histogram.TakeSnapshot();
+  EXPECT_EQ(snapshot.count(), 100);
+  EXPECT_EQ(snapshot.sum(), 5050);
+  EXPECT_EQ(snapshot.max(), 100);
+  EXPECT_DOUBLE_EQ(snapshot.Mean(), 50.5);
+  EXPECT_EQ(snapshot.Percentile(0), 1);
+  EXPECT_NEAR(snapshot.Percentile(0.5), 50, 50 / Histogram::kSubBuckets);
+  EXPECT_NEAR(snapshot.Percentile(0.99), 99, 99 / Histogram::kSubBuckets);
+}
+
+TEST(HistogramTest, EmptySnapshot) {
+  const Histogram::Snapshot snapshot = Histogram().TakeSnapshot();
+  EXPECT_EQ(snapshot.count(), 0);
+  EXPECT_EQ(snapshot.Mean(), 0);
+  EXPECT_EQ(snapshot.Percentile(0.5), 0);
+}
+
+TEST(HistogramTest, SnapshotDifference) {
+  Histogram histogram;
+  histogram.Record(10);
+  const Histogram::Snapshot before = histogram.TakeSnapshot();
+  histogram.Record(1000);
+  histogram.Record(1000);
+
+  Histogram::Snapshot interval = histogram.TakeSnapshot();
+  interval -= before;
+  EXPECT_EQ(interval.count(), 2);
+  EXPECT_EQ(interval.sum(), 2000);
+  EXPECT_EQ(interval.Percentile(0),
+            Histogram::BucketLowerBound(Histogram::BucketIndex(1000)));
+
+  interval += before;
+  EXPECT_EQ(interval.count(), 3);
+}
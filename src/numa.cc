@@ -0,0 +1,157 @@
+#include "diy/coro/numa.h"
+
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace numa {
+namespace {
+
+// Contents of a sysfs file, without the trailing newline, or an empty string
+// if it can't be read.
+std::string ReadSysfs(const std::string& path) {
+  std::ifstream in(path);
+  std::string contents;
+  std::getline(in, contents);
+  return contents;
+}
+
+cpu_set_t AllowedCpus() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    // Only happens on unsupported kernels; assume we may run anywhere.
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, &allowed);
+    }
+  }
+  return allowed;
+}
+
+std::vector<Node> ReadNodes() {
+  const cpu_set_t allowed = AllowedCpus();
+  auto is_allowed = [&](int cpu) {
+    return cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed);
+  };
+
+  std::vector<Node> nodes;
+  const std::string sysfs = "/sys/devices/system/node/";
+  for (int id : ParseList(ReadSysfs(sysfs + "online"))) {
+    Node node = {.id = id};
+    std::vector<int> cpus = ParseList(
+        ReadSysfs(absl::StrFormat("%snode%d/cpulist", sysfs, id)));
+    std::copy_if(cpus.begin(), cpus.end(), std::back_inserter(node.cpus),
+                 is_allowed);
+    if (!node.cpus.empty()) {
+      nodes.push_back(std::move(node));
+    }
+  }
+  if (nodes.empty()) {
+    Node node = {.id = 0};
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (is_allowed(cpu)) {
+        node.cpus.push_back(cpu);
+      }
+    }
+    nodes.push_back(std::move(node));
+  }
+  return nodes;
+}
+
+}  // namespace
+
+const std::vector<Node>& Nodes() {
+  static const std::vector<Node>* const nodes =
+      new std::vector<Node>(ReadNodes());
+  return *nodes;
+}
+
+const Node& CurrentNode() {
+  const std::vector<Node>& nodes = Nodes();
+  const int cpu = ::sched_getcpu();
+  for (const Node& node : nodes) {
+    if (std::find(node.cpus.begin(), node.cpus.end(), cpu) !=
+        node.cpus.end()) {
+      return node;
+    }
+  }
+  // The CPU is unknown, or sched_getcpu() failed.
+  return nodes.front();
+}
+
+std::vector<int> ParseList(std::string_view list) {
+  std::vector<int> values;
+  auto parse = [](std::string_view number) {
+    int value;
+    const auto [end, error] =
+        std::from_chars(number.data(), number.data() + number.size(), value);
+    if (error != std::errc() || end != number.data() + number.size()) {
+      throw std::invalid_argument(
+          absl::StrFormat("Malformed list element: '%s'", number));
+    }
+    return value;
+  };
+  while (!list.empty()) {
+    const std::size_t comma = std::min(list.find(','), list.size());
+    const std::string_view range = list.substr(0, comma);
+    list.remove_prefix(std::min(comma + 1, list.size()));
+
+    const std::size_t dash = range.find('-');
+    if (dash == std::string_view::npos) {
+      values.push_back(parse(range));
+      continue;
+    }
+    const int first = parse(range.substr(0, dash));
+    const int last = parse(range.substr(dash + 1));
+    for (int value = first; value <= last; ++value) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+cpu_set_t ToCpuSet(const std::vector<int>& cpus) {
+  const cpu_set_t allowed = AllowedCpus();
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+      throw std::invalid_argument(
+          absl::StrFormat("Process may not run on CPU %d", cpu));
+    }
+    CPU_SET(cpu, &set);
+  }
+  return set;
+}
+
+}  // namespace numa
+
+NumaExecutorPool::NumaExecutorPool(Options options)
+    : executors_per_node_(options.executors_per_node) {
+  if (executors_per_node_ == 0) {
+    throw std::invalid_argument("executors_per_node must be at least 1");
+  }
+  for (const numa::Node& node : numa::Nodes()) {
+    NodeExecutors& executors = nodes_.emplace_back();
+    SerialExecutor::Options executor_options = options.executor;
+    executor_options.cpus = node.cpus;
+    for (std::size_t i = 0; i < executors_per_node_; ++i) {
+      executors.executors.push_back(
+          std::make_unique<SerialExecutor>(executor_options));
+    }
+  }
+}
+
+SerialExecutor& NumaExecutorPool::Local() {
+  const numa::Node& node = numa::CurrentNode();
+  NodeExecutors& executors = nodes_[&node - numa::Nodes().data()];
+  const std::size_t next =
+      executors.next.fetch_add(1, std::memory_order::relaxed);
+  return *executors.executors[next % executors_per_node_];
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <sched.h>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "diy/coro/executor.h"
+
+// Machine topology, for placing executors' threads close to the memory and
+// the other threads they work with.
+namespace numa {
+
+// A NUMA node, and those of its CPUs that the process may run on.
+struct Node {
+  int id;
+  std::vector<int> cpus;
+};
+
+// The nodes that have CPUs the process may run on, in order of id. Read from
+// sysfs; if that isn't available, a single node 0 with all of the process's
+// CPUs.
+const std::vector<Node>& Nodes();
+
+// The node in Nodes() that the calling thread is currently running on.
+const Node& CurrentNode();
+
+// Parses a list of CPUs or nodes in the sysfs format, such as "0-3,8,10-11".
+std::vector<int> ParseList(std::string_view list);
+
+// Converts `cpus` to a cpu_set_t for sched_setaffinity() and friends. Throws
+// std::invalid_argument if the process may not run on one of them.
+cpu_set_t ToCpuSet(const std::vector<int>& cpus);
+
+}  // namespace numa
+
+// A set of SerialExecutors for each NUMA node, with their threads pinned to
+// the node's CPUs. Coroutines that share data should be scheduled onto
+// executors of the same node, so that their handoffs and the data stay within
+// the node's caches and memory; Local() picks one on the caller's node.
+//
+//   NumaExecutorPool pool;
+//   co_await pool.Local().Schedule();
+//   Broadcast<Quote> quotes = ...;  // Subscribers on pool.Local() too.
+class NumaExecutorPool {
+ public:
+  struct Options {
+    // Must be at least 1.
+    std::size_t executors_per_node = 1;
+    // Options for each executor, except for `cpus`, which is set to the
+    // node's.
+    SerialExecutor::Options executor;
+  };
+
+  // Throws std::invalid_argument if `options.executors_per_node` is 0.
+  explicit NumaExecutorPool(Options options);
+  NumaExecutorPool() : NumaExecutorPool(Options()) {}
+
+  // Number of nodes, in the order of numa::Nodes().
+  std::size_t nodes() const { return nodes_.size(); }
+  std::size_t executors_per_node() const { return executors_per_node_; }
+
+  // The `i`th executor of the `node`th node.
+  SerialExecutor& executor(std::size_t node, std::size_t i) {
+    return *nodes_[node].executors[i];
+  }
+
+  // An executor of the node the calling thread is running on, taking turns
+  // between them.
+  SerialExecutor& Local();
+
+ private:
+  struct NodeExecutors {
+    std::vector<std::unique_ptr<SerialExecutor>> executors;
+    std::atomic_size_t next = 0;
+  };
+
+  const std::size_t executors_per_node_;
+  std::deque<NodeExecutors> nodes_;
+};
@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/numa.h"
+#include "diy/coro/task.h"
+
+namespace {
+
+constexpr int kBatchSize = 10'000;
+
+enum Placement {
+  kUnpinned,
+  // Both executors pinned to the same CPU.
+  kSameCpu,
+  // Pinned to different CPUs of the same node.
+  kSameNode,
+  // Pinned to CPUs of different nodes.
+  kOtherNode,
+};
+
+// CPUs to pin two executors to for `placement`, or empty if the machine
+// doesn't allow it.
+std::vector<std::vector<int>> PlacementCpus(Placement placement) {
+  const std::vector<numa::Node>& nodes = numa::Nodes();
+  switch (placement) {
+    case kUnpinned:
+      return {{}, {}};
+    case kSameCpu:
+      return {{nodes[0].cpus[0]}, {nodes[0].cpus[0]}};
+    case kSameNode:
+      for (const numa::Node& node : nodes) {
+        if (node.cpus.size() >= 2) {
+          return {{node.cpus[0]}, {node.cpus[1]}};
+        }
+      }
+      return {};
+    case kOtherNode:
+      if (nodes.size() >= 2) {
+        return {{nodes[0].cpus[0]}, {nodes[1].cpus[0]}};
+      }
+      return {};
+  }
+  return {};
+}
+
+}  // namespace
+
+// Latency of a handoff between two executors, depending on where their
+// threads are placed.
+static void BM_PinnedPingPong(benchmark::State& state) {
+  auto task = [](SerialExecutor& a, SerialExecutor& b) -> Task<> {
+    for (int i = 0; i < kBatchSize / 2; ++i) {
+      co_await a.Schedule();
+      co_await b.Schedule();
+    }
+  };
+  const std::vector<std::vector<int>> cpus =
+      PlacementCpus(static_cast<Placement>(state.range(0)));
+  if (cpus.empty()) {
+    state.SkipWithError("Not enough CPUs or nodes for this placement.");
+    return;
+  }
+  SerialExecutor a({.cpus = cpus[0]});
+  SerialExecutor b({.cpus = cpus[1]});
+  for (auto _ : state) {
+    task(a, b).Wait();
+  }
+  state.SetItemsProcessed(kBatchSize * state.iterations());
+}
+
+BENCHMARK(BM_PinnedPingPong)
+    ->Arg(kUnpinned)
+    ->Arg(kSameCpu)
+    ->Arg(kSameNode)
+    ->Arg(kOtherNode)
+    ->ArgName("placement")
+    ->UseRealTime();
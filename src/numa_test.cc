@@ -0,0 +1,102 @@
+#include "diy/coro/numa.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sched.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+using testing::Contains;
+using testing::ElementsAre;
+using testing::IsEmpty;
+using testing::Not;
+
+namespace {
+
+// The CPU that a coroutine scheduled onto `executor` runs on.
+int CpuOf(Executor& executor) {
+  auto task = [](Executor& executor) -> Task<int> {
+    co_await executor.Schedule();
+    co_return ::sched_getcpu();
+  };
+  return task(executor).Wait();
+}
+
+}  // namespace
+
+TEST(NumaTest, ParseList) {
+  EXPECT_THAT(numa::ParseList(""), IsEmpty());
+  EXPECT_THAT(numa::ParseList("3"), ElementsAre(3));
+  EXPECT_THAT(numa::ParseList("0-3,8,10-11"),
+              ElementsAre(0, 1, 2, 3, 8, 10, 11));
+  EXPECT_THROW(numa::ParseList("0-x"), std::invalid_argument);
+}
+
+TEST(NumaTest, Nodes) {
+  const std::vector<numa::Node>& nodes = numa::Nodes();
+  ASSERT_THAT(nodes, Not(IsEmpty()));
+  for (const numa::Node& node : nodes) {
+    EXPECT_THAT(node.cpus, Not(IsEmpty()));
+  }
+  const numa::Node& current = numa::CurrentNode();
+  EXPECT_GE(&current, nodes.data());
+  EXPECT_LT(&current, nodes.data() + nodes.size());
+}
+
+TEST(NumaTest, PinnedExecutor) {
+  for (const numa::Node& node : numa::Nodes()) {
+    for (int cpu : node.cpus) {
+      SerialExecutor executor({.cpus = {cpu}});
+      EXPECT_EQ(CpuOf(executor), cpu);
+    }
+  }
+}
+
+TEST(NumaTest, PinningToUnavailableCpuThrows) {
+  EXPECT_THROW(SerialExecutor({.cpus = {-1}}), std::invalid_argument);
+  EXPECT_THROW(SerialExecutor({.cpus = {CPU_SETSIZE}}), std::invalid_argument);
+  // Even if the others are available.
+  EXPECT_THROW(numa::ToCpuSet({numa::Nodes()[0].cpus[0], -1}),
+               std::invalid_argument);
+}
+
+TEST(NumaTest, PoolWithoutExecutorsThrows) {
+  EXPECT_THROW(NumaExecutorPool({.executors_per_node = 0}),
+               std::invalid_argument);
+}
+
+TEST(NumaTest, Pool) {
+  NumaExecutorPool pool({.executors_per_node = 2});
+  ASSERT_EQ(pool.nodes(), numa::Nodes().size());
+  EXPECT_EQ(pool.executors_per_node(), 2);
+  for (std::size_t node = 0; node < pool.nodes(); ++node) {
+    for (std::size_t i = 0; i < pool.executors_per_node(); ++i) {
+      EXPECT_THAT(numa::Nodes()[node].cpus,
+                  Contains(CpuOf(pool.executor(node, i))));
+    }
+  }
+}
+
+TEST(NumaTest, PoolLocalTakesTurns) {
+  NumaExecutorPool pool({.executors_per_node = 2});
+  SerialExecutor* first = &pool.Local();
+  SerialExecutor* second = &pool.Local();
+  EXPECT_NE(first, second);
+  auto node_of = [&](SerialExecutor* executor) {
+    for (std::size_t node = 0; node < pool.nodes(); ++node) {
+      for (std::size_t i = 0; i < pool.executors_per_node(); ++i) {
+        if (&pool.executor(node, i) == executor) {
+          return node;
+        }
+      }
+    }
+    return pool.nodes();
+  };
+  EXPECT_LT(node_of(first), pool.nodes());
+  EXPECT_LT(node_of(second), pool.nodes());
+}
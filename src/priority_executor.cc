@@ -0,0 +1,219 @@
+#include "diy/coro/priority_executor.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "diy/coro/executor_internal.h"
+#include "diy/coro/histogram.h"
+
+using executor_internal::Add;
+using executor_internal::NowNanos;
+
+struct PriorityExecutor::SharedState {
+  struct Pending {
+    std::coroutine_handle<> handle;
+    int priority;
+    // NowNanos() at the time of Enqueue().
+    std::int64_t enqueued_at;
+  };
+
+  struct Lane {
+    // Only accessed by the runner thread.
+    std::deque<Pending> queue;
+
+    // Guarded by `mutex`.
+    std::uint64_t enqueued = 0;
+
+    // Only written by the runner thread.
+    std::atomic_uint64_t resumed = 0;
+    Histogram schedule_delay_ns;
+    Histogram slice_ns;
+    Histogram queue_depth;
+  };
+
+  const std::int64_t max_delay_ns;
+  std::vector<Lane> lanes;
+
+  executor_internal::WorkSignal signal;
+
+  // The executor, for Executor::Current(), until it is destroyed. The thread
+  // may outlive it.
+  std::atomic<Executor*> executor;
+
+  // Synchronizes access to `incoming` and the lanes' `enqueued`.
+  std::mutex mutex;
+  // Coroutines enqueued since the runner last moved them to their lanes.
+  std::vector<Pending> incoming;
+
+  // Only accessed by the runner thread: the lane of the coroutine being
+  // resumed, and the total size of the lanes' queues.
+  int running = 0;
+  std::size_t waiting = 0;
+
+  // Metrics only written by the runner thread.
+  std::atomic_uint64_t parks = 0;
+  std::atomic_int64_t parked_ns = 0;
+
+  SharedState(Options options, Executor* executor)
+      : max_delay_ns(absl::ToInt64Nanoseconds(options.max_delay)),
+        lanes(options.lanes),
+        executor(executor) {
+    assert(options.lanes > 0);
+  }
+
+  void Enqueue(std::coroutine_handle<> handle, int priority) {
+    assert(priority >= 0 && priority < static_cast<int>(lanes.size()));
+    const std::int64_t now = NowNanos();
+    {
+      auto lock = std::lock_guard(mutex);
+      incoming.push_back(
+          {.handle = handle, .priority = priority, .enqueued_at = now});
+      ++lanes[priority].enqueued;
+    }
+    // If already notified, the runner picks up our handle before resuming its
+    // next coroutine.
+    signal.Notify();
+  }
+
+  // The lane to resume a coroutine from next; there must be at least one
+  // waiting.
+  int NextLane(std::int64_t now) const {
+    int urgent = -1;
+    int overdue = -1;
+    std::int64_t longest_delay = max_delay_ns;
+    for (int i = 0; i < static_cast<int>(lanes.size()); ++i) {
+      const std::deque<Pending>& queue = lanes[i].queue;
+      if (queue.empty()) {
+        continue;
+      }
+      if (urgent < 0) {
+        urgent = i;
+      }
+      // Only the head of each lane needs checking, as it has waited longest.
+      const std::int64_t delay = now - queue.front().enqueued_at;
+      if (delay > longest_delay) {
+        overdue = i;
+        longest_delay = delay;
+      }
+    }
+    return overdue >= 0 ? overdue : urgent;
+  }
+
+  void Run() {
+    // Swapped with `incoming` so that both vectors' storage is reused.
+    std::vector<Pending> batch;
+    while (true) {
+      if (waiting == 0 && signal.idle()) {
+        Add(parks, 1);
+        const std::int64_t parked_at = NowNanos();
+        signal.Park();
+        Add(parked_ns, NowNanos() - parked_at);
+      }
+      // Checked before every coroutine, so that newly enqueued urgent work
+      // isn't held up behind the rest of a less urgent lane.
+      if (!signal.idle()) {
+        if (!signal.Consume()) {
+          return;
+        }
+        {
+          auto lock = std::lock_guard(mutex);
+          batch.swap(incoming);
+        }
+        for (const Pending& p : batch) {
+          lanes[p.priority].queue.push_back(p);
+        }
+        waiting += batch.size();
+        batch.clear();
+      }
+      if (waiting == 0) {
+        continue;
+      }
+
+      const std::int64_t start = NowNanos();
+      running = NextLane(start);
+      Lane& lane = lanes[running];
+      lane.queue_depth.Record(lane.queue.size());
+      const Pending p = lane.queue.front();
+      lane.queue.pop_front();
+      --waiting;
+
+      lane.schedule_delay_ns.Record(start - p.enqueued_at);
+      current_ = executor.load(std::memory_order::acquire);
+      p.handle.resume();
+      lane.slice_ns.Record(NowNanos() - start);
+      Add(lane.resumed, 1);
+    }
+  }
+
+  ExecutorMetrics LaneMetrics(const Lane& lane) {
+    ExecutorMetrics metrics;
+    {
+      auto lock = std::lock_guard(mutex);
+      metrics.enqueued = lane.enqueued;
+    }
+    metrics.resumed = lane.resumed.load(std::memory_order::relaxed);
+    metrics.schedule_delay_ns = lane.schedule_delay_ns.TakeSnapshot();
+    metrics.slice_ns = lane.slice_ns.TakeSnapshot();
+    metrics.queue_depth = lane.queue_depth.TakeSnapshot();
+    return metrics;
+  }
+};
+
+PriorityExecutor::PriorityExecutor(Options options)
+    : state_(std::make_shared<SharedState>(options, this)) {
+  std::thread([state = state_] { state->Run(); }).detach();
+}
+
+PriorityExecutor::~PriorityExecutor() {
+  state_->executor.store(nullptr, std::memory_order::release);
+  if (IsCurrent()) {
+    // Destroyed by one of our own coroutines, which carries on without us.
+    current_ = nullptr;
+  }
+  // Let the thread finish up asynchronously, so that the executor may be
+  // destroyed by a coroutine running on it.
+  state_->signal.Stop();
+}
+
+void PriorityExecutor::Enqueue(std::coroutine_handle<> handle) {
+  Enqueue(handle, IsCurrent() ? state_->running : 0);
+}
+
+void PriorityExecutor::Enqueue(std::coroutine_handle<> handle, int priority) {
+  // This await might unblock some event that causes us to be destructed. So the
+  // destruction may race with our access to state_.
+  std::shared_ptr<SharedState> state = state_;
+  state->Enqueue(handle, priority);
+}
+
+bool PriorityExecutor::IsRunningIn(int priority) const {
+  return IsCurrent() && state_->running == priority;
+}
+
+ExecutorMetrics PriorityExecutor::Metrics() const {
+  ExecutorMetrics total;
+  for (const SharedState::Lane& lane : state_->lanes) {
+    const ExecutorMetrics metrics = state_->LaneMetrics(lane);
+    total.enqueued += metrics.enqueued;
+    total.resumed += metrics.resumed;
+    total.schedule_delay_ns += metrics.schedule_delay_ns;
+    total.slice_ns += metrics.slice_ns;
+    total.queue_depth += metrics.queue_depth;
+  }
+  total.parks = state_->parks.load(std::memory_order::relaxed);
+  total.parked_time =
+      absl::Nanoseconds(state_->parked_ns.load(std::memory_order::relaxed));
+  return total;
+}
+
+ExecutorMetrics PriorityExecutor::LaneMetrics(int priority) const {
+  assert(priority >= 0 && priority < lanes());
+  return state_->LaneMetrics(state_->lanes[priority]);
+}
+
+int PriorityExecutor::lanes() const { return state_->lanes.size(); }
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <absl/time/time.h>
+
+#include <coroutine>
+#include <memory>
+
+#include "diy/coro/executor.h"
+
+// Executor that shares one thread between coroutines of differing urgency,
+// such as interactive requests and bulk backfills. Each coroutine is queued in
+// one of a fixed number of priority lanes, lane 0 being the most urgent.
+// Coroutines are resumed one at a time: from the most urgent non-empty lane,
+// and within a lane in the order they were scheduled. So that less urgent
+// lanes aren't starved under sustained load, a coroutine that has waited
+// longer than `max_delay` is resumed ahead of more urgent lanes; if several
+// have, the one that has waited longest goes first.
+//
+//   PriorityExecutor executor;
+//   co_await executor.Schedule(kBulkPriority);
+//
+// Coroutines enqueued without a priority go to lane 0 if enqueued from
+// another thread, such as when resuming from another executor. If enqueued
+// from the executor's own thread, such as by Yield(), they stay in the lane
+// of the coroutine that was running.
+//
+// Coroutines still queued when the executor is destroyed are never resumed.
+class PriorityExecutor : public Executor {
+ public:
+  struct Options {
+    int lanes = 2;
+    absl::Duration max_delay = absl::Milliseconds(10);
+  };
+
+  explicit PriorityExecutor(Options options);
+  PriorityExecutor() : PriorityExecutor(Options()) {}
+  ~PriorityExecutor() override;
+
+  // Awaitable that resumes execution of the current coroutine on this executor
+  // in lane `priority`. Continues inline if already running in that lane.
+  auto Schedule(int priority);
+  using Executor::Schedule;
+
+  void Enqueue(std::coroutine_handle<> handle) override;
+  void Enqueue(std::coroutine_handle<> handle, int priority);
+  bool IsCurrent() const override { return Current() == this; }
+
+  // Totals over all lanes.
+  ExecutorMetrics Metrics() const override;
+  // Metrics of the coroutines queued in lane `priority`, with queue_depth
+  // counting only that lane. Parking isn't attributed to any lane, so `parks`
+  // and `parked_time` are zero.
+  ExecutorMetrics LaneMetrics(int priority) const;
+
+  int lanes() const;
+
+ private:
+  struct SharedState;
+
+  // Returns true if called from a coroutine running in lane `priority` of this
+  // executor.
+  bool IsRunningIn(int priority) const;
+
+  // Shared with the thread, which may outlive the executor.
+  std::shared_ptr<SharedState> state_;
+};
+
+////////////////////
+// Implementation //
+////////////////////
+
+inline auto PriorityExecutor::Schedule(int priority) {
+  struct Awaiter {
+    PriorityExecutor* executor;
+    int priority;
+
+    bool await_ready() {
+      return executor->IsRunningIn(priority) && !ConsumeSliceBudget();
+    }
+
+    void await_suspend(std::coroutine_handle<> pending) {
+      executor->Enqueue(pending, priority);
+    }
+
+    constexpr void await_resume() {}
+  };
+  return Awaiter{.executor = this, .priority = priority};
+}
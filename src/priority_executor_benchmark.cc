@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+
+#include "benchmark_util.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/priority_executor.h"
+#include "diy/coro/task.h"
+
+namespace {
+
+constexpr int kBacklog = 100;
+constexpr int kBulkPriority = 1;
+
+// Schedules onto `executor`, in lane `priority` if it has lanes.
+template <typename E>
+auto ScheduleIn(E& executor, int priority) {
+  if constexpr (requires { executor.Schedule(priority); }) {
+    return executor.Schedule(priority);
+  } else {
+    return executor.Schedule();
+  }
+}
+
+// Stand-in for a slice of bulk work.
+void Spin(std::chrono::nanoseconds duration) {
+  const auto end = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+}  // namespace
+
+// Latency of an urgent coroutine scheduled while the executor has a backlog of
+// bulk coroutines, each running for a microsecond.
+template <typename E>
+static void BM_UrgentBehindBulk(benchmark::State& state) {
+  auto bulk = [](E& executor) -> Detached {
+    co_await ScheduleIn(executor, kBulkPriority);
+    Spin(std::chrono::microseconds(1));
+  };
+  auto urgent = [](E& executor) -> Task<LatencyRecorder::Clock::time_point> {
+    co_await ScheduleIn(executor, 0);
+    co_return LatencyRecorder::Clock::now();
+  };
+  // Completes once the backlog ahead of it in the bulk lane has run. Blocking
+  // rather than spinning keeps this thread from competing with the executor's.
+  auto drain = [](E& executor) -> Task<> {
+    co_await ScheduleIn(executor, kBulkPriority);
+  };
+
+  E executor;
+  LatencyRecorder latency(state.max_iterations);
+  for (auto _ : state) {
+    for (int i = 0; i < kBacklog; ++i) {
+      bulk(executor);
+    }
+    const auto start = LatencyRecorder::Clock::now();
+    latency.Record(urgent(executor).Wait() - start);
+    drain(executor).Wait();
+  }
+  latency.Report(state);
+}
+
+BENCHMARK(BM_UrgentBehindBulk<SerialExecutor>)->UseRealTime();
+BENCHMARK(BM_UrgentBehindBulk<PriorityExecutor>)->UseRealTime();
@@ -0,0 +1,192 @@
+#include "diy/coro/priority_executor.h"
+
+#include <absl/synchronization/notification.h>
+#include <absl/time/clock.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "diy/coro/blocking_pool.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+using testing::ElementsAre;
+
+namespace {
+
+// Holds up `executor`'s thread, so that coroutines can be queued on it in a
+// known order before any of them run.
+class Blocker {
+ public:
+  explicit Blocker(PriorityExecutor& executor)
+      : executor_(executor), thread_([this] { Block().Wait(); }) {
+    blocked_.WaitForNotification();
+  }
+
+  ~Blocker() { release_.Notify(); }
+
+ private:
+  Task<> Block() {
+    co_await executor_.Schedule(0);
+    blocked_.Notify();
+    release_.WaitForNotification();
+  }
+
+  PriorityExecutor& executor_;
+  absl::Notification blocked_;
+  absl::Notification release_;
+  std::jthread thread_;
+};
+
+// Schedules coroutines onto lanes of an executor, each of which records its
+// lane once resumed.
+class Recorder {
+ public:
+  explicit Recorder(PriorityExecutor& executor) : executor_(executor) {}
+
+  // Queues a coroutine on lane `priority`, returning once it is queued.
+  void Schedule(int priority) {
+    const std::uint64_t enqueued = executor_.Metrics().enqueued;
+    threads_.emplace_back([this, priority] { Record(priority).Wait(); });
+    while (executor_.Metrics().enqueued == enqueued) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Waits for the queued coroutines to run, and returns their lanes in the
+  // order they ran.
+  std::vector<int> Wait() {
+    threads_.clear();
+    return order_;
+  }
+
+ private:
+  Task<> Record(int priority) {
+    co_await executor_.Schedule(priority);
+    auto lock = std::lock_guard(mutex_);
+    order_.push_back(priority);
+  }
+
+  PriorityExecutor& executor_;
+  std::mutex mutex_;
+  std::vector<int> order_;
+  std::vector<std::jthread> threads_;
+};
+
+}  // namespace
+
+TEST(PriorityExecutorTest, CurrentExecutor) {
+  PriorityExecutor executor;
+  auto task = [](PriorityExecutor& executor) -> Task<Executor*> {
+    co_await executor.Schedule(1);
+    EXPECT_TRUE(executor.IsCurrent());
+    co_return Executor::Current();
+  };
+  EXPECT_EQ(task(executor).Wait(), &executor);
+  EXPECT_FALSE(executor.IsCurrent());
+}
+
+TEST(PriorityExecutorTest, StrictPriority) {
+  PriorityExecutor executor({.lanes = 3, .max_delay = absl::Hours(1)});
+  Recorder recorder(executor);
+  {
+    Blocker blocker(executor);
+    for (int priority : {2, 1, 0, 2, 1, 0}) {
+      recorder.Schedule(priority);
+    }
+  }
+  EXPECT_THAT(recorder.Wait(), ElementsAre(0, 0, 1, 1, 2, 2));
+}
+
+TEST(PriorityExecutorTest, OverdueCoroutinesRunFirst) {
+  PriorityExecutor executor({.max_delay = absl::Milliseconds(10)});
+  Recorder recorder(executor);
+  {
+    Blocker blocker(executor);
+    recorder.Schedule(1);
+    absl::SleepFor(absl::Milliseconds(20));
+    recorder.Schedule(0);
+    recorder.Schedule(1);
+  }
+  // Only the first bulk coroutine had waited too long.
+  EXPECT_THAT(recorder.Wait(), ElementsAre(1, 0, 1));
+}
+
+TEST(PriorityExecutorTest, ScheduleOntoSameLaneContinuesInline) {
+  auto task = [](PriorityExecutor& executor) -> Task<> {
+    co_await executor.Schedule(1);
+    co_await executor.Schedule(1);
+    co_await executor.Schedule(0);
+  };
+
+  PriorityExecutor executor;
+  task(executor).Wait();
+  EXPECT_EQ(executor.LaneMetrics(0).enqueued, 1);
+  EXPECT_EQ(executor.LaneMetrics(1).enqueued, 1);
+}
+
+TEST(PriorityExecutorTest, YieldStaysInLane) {
+  auto task = [](PriorityExecutor& executor) -> Task<> {
+    co_await executor.Schedule(1);
+    co_await Yield();
+  };
+
+  PriorityExecutor executor;
+  task(executor).Wait();
+  EXPECT_EQ(executor.LaneMetrics(0).enqueued, 0);
+  EXPECT_EQ(executor.LaneMetrics(1).enqueued, 2);
+}
+
+TEST(PriorityExecutorTest, EnqueueFromOtherThreadUsesLaneZero) {
+  auto task = [](PriorityExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+  };
+
+  PriorityExecutor executor;
+  task(executor).Wait();
+  EXPECT_EQ(executor.LaneMetrics(0).enqueued, 1);
+}
+
+TEST(PriorityExecutorTest, Metrics) {
+  PriorityExecutor executor;
+  Recorder recorder(executor);
+  {
+    Blocker blocker(executor);
+    recorder.Schedule(1);
+    recorder.Schedule(1);
+    recorder.Schedule(0);
+  }
+  recorder.Wait();
+
+  const ExecutorMetrics urgent = executor.LaneMetrics(0);
+  const ExecutorMetrics bulk = executor.LaneMetrics(1);
+  const ExecutorMetrics total = executor.Metrics();
+  // Includes the blocker.
+  EXPECT_EQ(urgent.enqueued, 2);
+  EXPECT_EQ(bulk.enqueued, 2);
+  EXPECT_EQ(total.enqueued, 4);
+  // The last coroutine to complete may not have been counted as resumed yet.
+  EXPECT_GE(urgent.resumed + bulk.resumed, 3);
+  EXPECT_EQ(total.schedule_delay_ns.count(),
+            urgent.schedule_delay_ns.count() +
+                bulk.schedule_delay_ns.count());
+  // Both bulk coroutines were queued at once.
+  EXPECT_EQ(bulk.queue_depth.max(), 2);
+  EXPECT_EQ(urgent.queue_depth.max(), 1);
+  EXPECT_GE(total.parks, 1);
+}
+
+TEST(PriorityExecutorTest, DestroyFromOwnThread) {
+  auto task = [](PriorityExecutor* executor) -> Task<int> {
+    co_await executor->Schedule(0);
+    delete executor;
+    EXPECT_EQ(Executor::Current(), nullptr);
+    // Would otherwise try to return to the destroyed executor.
+    co_return co_await Offload([] { return 1; });
+  };
+  EXPECT_EQ(task(new PriorityExecutor).Wait(), 1);
+}
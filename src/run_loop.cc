@@ -0,0 +1,70 @@
+#include "diy/coro/run_loop.h"
+
+#include <absl/time/clock.h>
+
+void RunLoop::Enqueue(std::coroutine_handle<> handle) {
+  auto lock = std::lock_guard(mutex_);
+  ready_.push_back(handle);
+  ++enqueued_;
+  if (parked_) {
+    // Under the lock, as the woken thread may destroy the loop as soon as it
+    // wakes.
+    work_available_.notify_one();
+  }
+}
+
+ExecutorMetrics RunLoop::Metrics() const {
+  auto lock = std::lock_guard(mutex_);
+  return {
+      .enqueued = enqueued_,
+      .resumed = resumed_,
+      .parks = parks_,
+      .parked_time = parked_time_,
+  };
+}
+
+std::size_t RunLoop::RunUntilIdle() {
+  Executor* const previous = std::exchange(current_, this);
+  std::size_t resumed = 0;
+  while (true) {
+    {
+      auto lock = std::lock_guard(mutex_);
+      if (ready_.empty()) {
+        break;
+      }
+      resumed_ += ready_.size();
+      // Swap rather than move, to reuse both vectors' capacity.
+      batch_.swap(ready_);
+    }
+    for (std::coroutine_handle<> handle : batch_) {
+      handle.resume();
+    }
+    resumed += batch_.size();
+    batch_.clear();
+  }
+  current_ = previous;
+  return resumed;
+}
+
+void RunLoop::RunUntil(const bool& done) {
+  while (true) {
+    RunUntilIdle();
+    if (done) {
+      return;
+    }
+    if (OnIdle()) {
+      continue;
+    }
+    auto lock = std::unique_lock(mutex_);
+    if (!ready_.empty()) {
+      continue;
+    }
+    // Waiting on another thread.
+    ++parks_;
+    const absl::Time start = absl::Now();
+    parked_ = true;
+    work_available_.wait(lock, [&] { return !ready_.empty(); });
+    parked_ = false;
+    parked_time_ += absl::Now() - start;
+  }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <absl/time/time.h>
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+// Executor without a thread of its own, whose coroutines run on the thread
+// that drives it through RunUntilIdle() or SyncWait(). Saves the handoff to
+// another thread, and the wakeup of the blocked caller when the work is done,
+// that Task::Wait() costs; for the main functions of tools and benchmarks.
+//
+//   int main() {
+//     RunLoop loop;
+//     return SyncWait(Main(loop), loop);  // Main() schedules onto `loop`.
+//   }
+//
+// Coroutines may be enqueued from any thread, and run in the order they were
+// enqueued.
+//
+// Also the basis of executors that run other work on the driving thread once
+// their coroutines are idle, such as SimulatedExecutor's timers.
+class RunLoop : public Executor {
+ public:
+  RunLoop() = default;
+  // Coroutines still enqueued are abandoned.
+  ~RunLoop() override = default;
+
+  void Enqueue(std::coroutine_handle<> handle) override;
+  bool IsCurrent() const override { return Current() == this; }
+  ExecutorMetrics Metrics() const override;
+
+  // Runs coroutines until none are ready. Returns the number of coroutines
+  // resumed. Must not be called from a coroutine running on this loop, and
+  // neither must RunUntil().
+  std::size_t RunUntilIdle();
+
+  // Runs coroutines until one of them sets `done`. Whenever none are ready,
+  // calls OnIdle(), and if that has nothing to do either, parks the calling
+  // thread until a coroutine is enqueued.
+  void RunUntil(const bool& done);
+
+ protected:
+  // Called on the driving thread when no coroutines are ready. Returns true if
+  // it did something that may have made some ready.
+  virtual bool OnIdle() { return false; }
+
+ private:
+  mutable std::mutex mutex_;
+  // Signalled when a coroutine is enqueued while the loop is parked.
+  std::condition_variable work_available_;
+  std::vector<std::coroutine_handle<>> ready_;
+  bool parked_ = false;
+  std::uint64_t enqueued_ = 0;
+  std::uint64_t resumed_ = 0;
+  std::uint64_t parks_ = 0;
+  absl::Duration parked_time_;
+
+  // Only accessed by the thread driving the loop.
+  std::vector<std::coroutine_handle<>> batch_;
+};
+
+// Runs `task` on `loop`, driving the loop on the calling thread until `task`
+// completes, and returns its result or rethrows its exception. Coroutines
+// that `task` schedules onto `loop` run inline; if `task` moves to other
+// executors, the calling thread parks until it is back.
+template <typename T>
+T SyncWait(Task<T> task, RunLoop& loop);
+
+// As above, on a loop of its own.
+template <typename T>
+T SyncWait(Task<T> task) {
+  RunLoop loop;
+  return SyncWait(std::move(task), loop);
+}
+
+////////////////////
+// Implementation //
+////////////////////
+
+template <typename T>
+T SyncWait(Task<T> task, RunLoop& loop) {
+  using Result = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+  std::optional<Result> result;
+  std::exception_ptr exception;
+  bool done = false;
+  [](RunLoop& loop, Task<T> task, std::optional<Result>& result,
+     std::exception_ptr& exception, bool& done) -> task_internal::Detached {
+    co_await loop.Schedule();
+    // Back on the loop however `task` completes, so that `done` is only
+    // accessed by the calling thread.
+    try {
+      if constexpr (std::is_void_v<T>) {
+        co_await std::move(task).ResumeOnOrigin();
+        result.emplace();
+      } else {
+        result.emplace(co_await std::move(task).ResumeOnOrigin());
+      }
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    done = true;
+  }(loop, std::move(task), result, exception, done);
+  loop.RunUntil(done);
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*result);
+  }
+}
@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/run_loop.h"
+#include "diy/coro/task.h"
+
+// Cost of synchronously running a short task from outside any executor:
+// handing it to a SerialExecutor and blocking in Task::Wait() until it is
+// done, or running it inline with SyncWait().
+static void BM_SyncRunSerialExecutor(benchmark::State& state) {
+  auto task = [](SerialExecutor& executor) -> Task<int> {
+    co_await executor.Schedule();
+    co_return 1;
+  };
+  SerialExecutor executor;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(task(executor).Wait());
+  }
+}
+
+static void BM_SyncRunRunLoop(benchmark::State& state) {
+  auto task = [](RunLoop& loop) -> Task<int> {
+    co_await loop.Schedule();
+    co_return 1;
+  };
+  RunLoop loop;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SyncWait(task(loop), loop));
+  }
+}
+
+BENCHMARK(BM_SyncRunSerialExecutor)->UseRealTime();
+BENCHMARK(BM_SyncRunRunLoop)->UseRealTime();
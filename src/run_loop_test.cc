@@ -0,0 +1,101 @@
+#include "diy/coro/run_loop.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+
+#include "diy/coro/blocking_pool.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+TEST(RunLoopTest, SyncWait) {
+  auto task = []() -> Task<int> { co_return 1; };
+
+  RunLoop loop;
+  EXPECT_EQ(SyncWait(task(), loop), 1);
+  EXPECT_EQ(SyncWait(task()), 1);
+}
+
+TEST(RunLoopTest, SyncWaitVoid) {
+  bool ran = false;
+  auto task = [](bool& ran) -> Task<> {
+    ran = true;
+    co_return;
+  };
+
+  SyncWait(task(ran));
+  EXPECT_TRUE(ran);
+}
+
+TEST(RunLoopTest, SyncWaitRethrows) {
+  auto task = []() -> Task<> {
+    throw std::runtime_error("error");
+    co_return;
+  };
+
+  EXPECT_THROW(SyncWait(task()), std::runtime_error);
+}
+
+TEST(RunLoopTest, RunsOnCallingThread) {
+  auto task = [](RunLoop& loop) -> Task<std::thread::id> {
+    co_await loop.Schedule();
+    EXPECT_TRUE(loop.IsCurrent());
+    EXPECT_EQ(Executor::Current(), &loop);
+    co_return std::this_thread::get_id();
+  };
+
+  RunLoop loop;
+  EXPECT_EQ(SyncWait(task(loop), loop), std::this_thread::get_id());
+  EXPECT_FALSE(loop.IsCurrent());
+  EXPECT_EQ(Executor::Current(), nullptr);
+}
+
+TEST(RunLoopTest, WaitsForOtherThreads) {
+  auto task = [](RunLoop& loop) -> Task<std::thread::id> {
+    co_await BlockingPool::Default().Schedule();
+    const std::thread::id id = std::this_thread::get_id();
+    co_await loop.Schedule();
+    co_return id;
+  };
+
+  RunLoop loop;
+  EXPECT_NE(SyncWait(task(loop), loop), std::this_thread::get_id());
+}
+
+TEST(RunLoopTest, Offload) {
+  auto task = [](RunLoop& loop) -> Task<int> {
+    co_await loop.Schedule();
+    const int value = co_await Offload([] { return 1; });
+    EXPECT_TRUE(loop.IsCurrent());
+    co_return value;
+  };
+
+  RunLoop loop;
+  EXPECT_EQ(SyncWait(task(loop), loop), 1);
+}
+
+TEST(RunLoopTest, RunUntilIdle) {
+  RunLoop loop;
+  EXPECT_EQ(loop.RunUntilIdle(), 0);
+  loop.Enqueue(std::noop_coroutine());
+  loop.Enqueue(std::noop_coroutine());
+  EXPECT_EQ(loop.RunUntilIdle(), 2);
+  EXPECT_EQ(loop.RunUntilIdle(), 0);
+}
+
+TEST(RunLoopTest, Metrics) {
+  auto task = []() -> Task<> {
+    for (int i = 0; i < 3; ++i) {
+      co_await Yield();
+    }
+  };
+
+  RunLoop loop;
+  SyncWait(task(), loop);
+  // The initial Schedule(), and one for each Yield().
+  const ExecutorMetrics metrics = loop.Metrics();
+  EXPECT_EQ(metrics.enqueued, 4);
+  EXPECT_EQ(metrics.resumed, 4);
+  EXPECT_EQ(metrics.parks, 0);
+}
@@ -0,0 +1,88 @@
+#include "diy/coro/simulated_executor.h"
+
+#include <algorithm>
+
+// Only awaited on the driving thread.
+struct SimulatedExecutor::TimerAwaiter {
+  SimulatedExecutor& executor;
+  absl::Time time;
+
+  bool await_ready() { return time <= executor.Now(); }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    executor.timers_.emplace(time, handle);
+  }
+
+  constexpr void await_resume() {}
+};
+
+absl::Time SimulatedExecutor::Now() const {
+  auto lock = std::lock_guard(mutex_);
+  return now_;
+}
+
+Task<> SimulatedExecutor::Sleep(absl::Time time) {
+  // Onto the driving thread first, which also wakes it if it's parked waiting
+  // on another thread.
+  co_await Schedule();
+  co_await TimerAwaiter{.executor = *this, .time = time};
+}
+
+void SimulatedExecutor::Spawn(Task<> task) {
+  [](SimulatedExecutor& executor, Task<> task) -> task_internal::Detached {
+    co_await executor.Schedule();
+    // Back on the driving thread however `task` completes, so that
+    // `spawn_exception_` is only accessed there.
+    try {
+      co_await std::move(task).ResumeOnOrigin();
+    } catch (...) {
+      executor.spawn_exception_ = std::current_exception();
+    }
+  }(*this, std::move(task));
+}
+
+std::size_t SimulatedExecutor::RunUntilIdle() {
+  const std::size_t resumed = RunLoop::RunUntilIdle();
+  RethrowSpawnException();
+  return resumed;
+}
+
+void SimulatedExecutor::AdvanceTo(absl::Time time) {
+  FireTimers(time);
+  RethrowSpawnException();
+}
+
+bool SimulatedExecutor::OnIdle() {
+  if (timers_.empty()) {
+    return false;
+  }
+  FireTimers(timers_.begin()->first);
+  return true;
+}
+
+void SimulatedExecutor::FireTimers(absl::Time time) {
+  RunLoop::RunUntilIdle();
+  while (!timers_.empty() && timers_.begin()->first <= time) {
+    const absl::Time deadline = timers_.begin()->first;
+    {
+      auto lock = std::lock_guard(mutex_);
+      now_ = deadline;
+    }
+    // Fire every timer due at the earliest deadline, in the order they were
+    // set.
+    const auto due = timers_.upper_bound(deadline);
+    for (auto it = timers_.begin(); it != due; ++it) {
+      Enqueue(it->second);
+    }
+    timers_.erase(timers_.begin(), due);
+    RunLoop::RunUntilIdle();
+  }
+  auto lock = std::lock_guard(mutex_);
+  now_ = std::max(now_, time);
+}
+
+void SimulatedExecutor::RethrowSpawnException() {
+  if (spawn_exception_) {
+    std::rethrow_exception(std::exchange(spawn_exception_, nullptr));
+  }
+}
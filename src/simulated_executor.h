@@ -0,0 +1,102 @@
+#pragma once
+
+#include <absl/time/time.h>
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "diy/coro/executor.h"
+#include "diy/coro/run_loop.h"
+#include "diy/coro/task.h"
+
+// Executor with a virtual clock, for tests and simulations. It has no thread
+// of its own: coroutines only run when the thread driving it calls
+// RunUntilIdle(), AdvanceTo() or Run(), and then one at a time on that thread,
+// in the order they were scheduled. Sleep() doesn't wait: the clock stands
+// still while there are coroutines to run, and then jumps to the earliest
+// pending timer. So code written against Executor's Schedule(), Now() and
+// Sleep() runs at CPU speed, and reproducibly.
+//
+//   SimulatedExecutor executor;
+//   // Retries for an hour of virtual time, in milliseconds of real time.
+//   const Status status = executor.Run(FetchWithRetries(executor, request));
+//
+// Coroutines may be enqueued from other threads, such as when resuming from a
+// BlockingPool, but then the order they run in depends on those threads.
+class SimulatedExecutor : public RunLoop {
+ public:
+  explicit SimulatedExecutor(absl::Time start = absl::UnixEpoch())
+      : now_(start) {}
+
+  // Coroutines and timers still pending are abandoned.
+  ~SimulatedExecutor() override = default;
+
+  absl::Time Now() const override;
+  Task<> Sleep(absl::Time time) override;
+
+  // Starts `task` on this executor, the next time it runs coroutines. An
+  // exception escaping `task` is rethrown when the RunUntilIdle(), AdvanceTo()
+  // or Run() call during which it escaped returns.
+  void Spawn(Task<> task);
+
+  // Runs coroutines until none are ready, without advancing the clock.
+  // Returns the number of coroutines resumed. Unlike RunLoop's, rethrows
+  // exceptions escaping Spawn()ed tasks.
+  std::size_t RunUntilIdle();
+
+  // Runs coroutines and fires the timers due by `time` in deadline order,
+  // advancing the clock to each deadline in turn and running until idle in
+  // between, then sets the clock to `time` if it is later.
+  void AdvanceTo(absl::Time time);
+  void AdvanceBy(absl::Duration duration) { AdvanceTo(Now() + duration); }
+
+  // Runs `task` on this executor until it completes, advancing the clock as
+  // needed, and returns its result. If `task` is waiting on another thread,
+  // with nothing to run and no timers pending, blocks until that thread
+  // enqueues a coroutine.
+  template <typename T>
+  T Run(Task<T> task);
+
+ protected:
+  // Advances the clock to the earliest pending timer, if any.
+  bool OnIdle() override;
+
+ private:
+  struct TimerAwaiter;
+
+  // AdvanceTo() without rethrowing exceptions escaping Spawn()ed tasks.
+  void FireTimers(absl::Time time);
+  void RethrowSpawnException();
+
+  // Guards `now_`, which other threads may read through Now().
+  mutable std::mutex mutex_;
+  absl::Time now_;
+
+  // Only accessed by the thread driving the executor.
+  // Ordered by deadline, and then by when they were set.
+  std::multimap<absl::Time, std::coroutine_handle<>> timers_;
+  std::exception_ptr spawn_exception_;
+};
+
+////////////////////
+// Implementation //
+////////////////////
+
+template <typename T>
+T SimulatedExecutor::Run(Task<T> task) {
+  // Exceptions of Spawn()ed tasks are held back until SyncWait() has seen
+  // `task` through.
+  if constexpr (std::is_void_v<T>) {
+    SyncWait(std::move(task), *this);
+    RethrowSpawnException();
+  } else {
+    T result = SyncWait(std::move(task), *this);
+    RethrowSpawnException();
+    return result;
+  }
+}
@@ -0,0 +1,213 @@
+#include "diy/coro/simulated_executor.h"
+
+#include <absl/time/clock.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "diy/coro/blocking_pool.h"
+#include "diy/coro/executor.h"
+#include "diy/coro/task.h"
+
+using testing::ElementsAre;
+
+TEST(SimulatedExecutorTest, Run) {
+  auto task = [](SimulatedExecutor& executor) -> Task<int> {
+    co_await executor.Schedule();
+    EXPECT_TRUE(executor.IsCurrent());
+    co_return 1;
+  };
+
+  SimulatedExecutor executor;
+  EXPECT_EQ(executor.Run(task(executor)), 1);
+  EXPECT_FALSE(executor.IsCurrent());
+}
+
+TEST(SimulatedExecutorTest, RunRethrows) {
+  auto task = []() -> Task<> {
+    throw std::runtime_error("error");
+    co_return;
+  };
+
+  SimulatedExecutor executor;
+  EXPECT_THROW(executor.Run(task()), std::runtime_error);
+}
+
+TEST(SimulatedExecutorTest, SleepUsesVirtualTime) {
+  auto task = [](Executor& executor) -> Task<absl::Duration> {
+    const absl::Time start = executor.Now();
+    co_await executor.Sleep(start + absl::Hours(1));
+    co_return executor.Now() - start;
+  };
+
+  const absl::Time real_start = absl::Now();
+  SimulatedExecutor executor;
+  EXPECT_EQ(executor.Run(task(executor)), absl::Hours(1));
+  EXPECT_LT(absl::Now() - real_start, absl::Seconds(10));
+}
+
+TEST(SimulatedExecutorTest, TimersFireInDeadlineOrder) {
+  auto sleeper = [](SimulatedExecutor& executor, std::vector<std::string>& log,
+                    std::string name, absl::Duration duration) -> Task<> {
+    co_await executor.Sleep(executor.Now() + duration);
+    log.push_back(name);
+  };
+
+  SimulatedExecutor executor;
+  std::vector<std::string> log;
+  executor.Spawn(sleeper(executor, log, "3s", absl::Seconds(3)));
+  executor.Spawn(sleeper(executor, log, "1s", absl::Seconds(1)));
+  executor.Spawn(sleeper(executor, log, "2s a", absl::Seconds(2)));
+  executor.Spawn(sleeper(executor, log, "2s b", absl::Seconds(2)));
+  executor.AdvanceBy(absl::Seconds(10));
+  EXPECT_THAT(log, ElementsAre("1s", "2s a", "2s b", "3s"));
+}
+
+TEST(SimulatedExecutorTest, AdvanceToOnlyFiresDueTimers) {
+  SimulatedExecutor executor;
+  const absl::Time start = executor.Now();
+  bool fired = false;
+  executor.Spawn([](SimulatedExecutor& executor, bool& fired) -> Task<> {
+    co_await executor.Sleep(executor.Now() + absl::Seconds(10));
+    fired = true;
+  }(executor, fired));
+
+  executor.AdvanceTo(start + absl::Seconds(5));
+  EXPECT_FALSE(fired);
+  EXPECT_EQ(executor.Now(), start + absl::Seconds(5));
+  executor.AdvanceTo(start + absl::Seconds(10));
+  EXPECT_TRUE(fired);
+  EXPECT_EQ(executor.Now(), start + absl::Seconds(10));
+}
+
+TEST(SimulatedExecutorTest, RunUntilIdleDoesNotAdvanceClock) {
+  SimulatedExecutor executor;
+  const absl::Time start = executor.Now();
+  int steps = 0;
+  executor.Spawn([](SimulatedExecutor& executor, int& steps) -> Task<> {
+    ++steps;
+    co_await Yield();
+    ++steps;
+    co_await executor.Sleep(executor.Now() + absl::Seconds(1));
+    ++steps;
+  }(executor, steps));
+
+  EXPECT_EQ(executor.RunUntilIdle(), 2);
+  EXPECT_EQ(steps, 2);
+  EXPECT_EQ(executor.Now(), start);
+  EXPECT_EQ(executor.RunUntilIdle(), 0);
+}
+
+TEST(SimulatedExecutorTest, SpawnedExceptionRethrown) {
+  SimulatedExecutor executor;
+  executor.Spawn([]() -> Task<> {
+    throw std::runtime_error("error");
+    co_return;
+  }());
+  EXPECT_THROW(executor.RunUntilIdle(), std::runtime_error);
+}
+
+TEST(SimulatedExecutorTest, SpawnedExceptionFromOtherThreadRethrown) {
+  SimulatedExecutor executor;
+  executor.Spawn([]() -> Task<> {
+    co_await BlockingPool::Default().Schedule();
+    throw std::runtime_error("error");
+  }());
+
+  // Rethrown once the pool's thread hands the task back.
+  bool thrown = false;
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (!thrown && absl::Now() < deadline) {
+    try {
+      executor.RunUntilIdle();
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_TRUE(thrown);
+}
+
+TEST(SimulatedExecutorTest, SpawnedExceptionRethrownAfterRun) {
+  SimulatedExecutor executor;
+  executor.Spawn([]() -> Task<> {
+    throw std::runtime_error("error");
+    co_return;
+  }());
+
+  auto task = [](SimulatedExecutor& executor, bool& completed) -> Task<> {
+    co_await executor.Sleep(executor.Now() + absl::Seconds(1));
+    completed = true;
+  };
+  // Held back until the task has completed, rather than abandoning it.
+  bool completed = false;
+  EXPECT_THROW(executor.Run(task(executor, completed)), std::runtime_error);
+  EXPECT_TRUE(completed);
+  EXPECT_NO_THROW(executor.RunUntilIdle());
+}
+
+TEST(SimulatedExecutorTest, Reproducible) {
+  // Many coroutines sleeping pseudo-random amounts finish in the same order
+  // every time.
+  auto simulate = [] {
+    auto sleeper = [](SimulatedExecutor& executor, std::vector<int>& order,
+                      int id) -> Task<> {
+      for (int i = 0; i < 3; ++i) {
+        co_await executor.Sleep(executor.Now() +
+                                absl::Milliseconds((id * 7919 + i) % 13));
+      }
+      order.push_back(id);
+    };
+    SimulatedExecutor executor;
+    std::vector<int> order;
+    for (int id = 0; id < 100; ++id) {
+      executor.Spawn(sleeper(executor, order, id));
+    }
+    executor.AdvanceBy(absl::Minutes(1));
+    return order;
+  };
+  const std::vector<int> order = simulate();
+  EXPECT_EQ(order.size(), 100);
+  EXPECT_EQ(simulate(), order);
+}
+
+TEST(SimulatedExecutorTest, RunWaitsForOtherThreads) {
+  auto task = [](SimulatedExecutor& executor) -> Task<int> {
+    co_await executor.Schedule();
+    const int value = co_await Offload([] {
+      absl::SleepFor(absl::Milliseconds(10));
+      return 1;
+    });
+    EXPECT_TRUE(executor.IsCurrent());
+    co_return value;
+  };
+
+  SimulatedExecutor executor;
+  EXPECT_EQ(executor.Run(task(executor)), 1);
+}
+
+TEST(SimulatedExecutorTest, RunCompletingOnOtherThread) {
+  auto task = []() -> Task<int> {
+    co_await BlockingPool::Default().Schedule();
+    co_return 1;
+  };
+
+  SimulatedExecutor executor;
+  EXPECT_EQ(executor.Run(task()), 1);
+}
+
+TEST(SimulatedExecutorTest, Metrics) {
+  auto task = [](SimulatedExecutor& executor) -> Task<> {
+    co_await executor.Schedule();
+    co_await executor.Sleep(executor.Now() + absl::Seconds(1));
+  };
+
+  SimulatedExecutor executor;
+  executor.Run(task(executor));
+  const ExecutorMetrics metrics = executor.Metrics();
+  EXPECT_EQ(metrics.enqueued, 2);
+  EXPECT_EQ(metrics.resumed, 2);
+}
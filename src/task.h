@@ -9,9 +9,38 @@
 #include <type_traits>
 #include <utility>
 
+#include "diy/coro/arena.h"
+#include "diy/coro/frame_allocator.h"
 #include "diy/coro/handle.h"
+#include "diy/coro/trace.h"
 #include "diy/coro/traits.h"
 
+class Executor;
+
+namespace task_internal {
+// Defined in executor.cc, as executor.h depends on this header.
+
+// Executor::Current().
+Executor* CurrentExecutor();
+
+// Returns `handle` if already running on `executor`; otherwise schedules it
+// there and returns a no-op coroutine.
+std::coroutine_handle<> TransferTo(Executor& executor,
+                                   std::coroutine_handle<> handle);
+
+// Coroutine that starts running immediately and frees its own frame when it
+// completes. Exceptions must not escape it.
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+}  // namespace task_internal
+
 template <typename T = void>
 class Task {
   struct Promise;
@@ -45,7 +74,20 @@ class Task {
   // Creates an awaitable object that awaits the completion of this task.
   auto operator co_await() &&;
 
+  // Like awaiting the task directly, except that if the task completes on a
+  // different executor than the one the awaiting coroutine was running on,
+  // the awaiting coroutine is rescheduled back onto its own executor rather
+  // than continuing on the task's. When the task completes on the same
+  // executor, the awaiting coroutine is resumed directly.
+  //
+  //   co_await executor.Schedule();
+  //   Response response = co_await Fetch(request).ResumeOnOrigin();
+  //   assert(executor.IsCurrent());
+  auto ResumeOnOrigin() &&;
+
   // Synchronously waits for this task to complete, and returns its value.
+  // The task runs on whichever threads it schedules itself onto; see
+  // SyncWait() to run it on the calling thread instead.
   T Wait() &&;
 
   // Creates a new Task whose value is the result of applying `f` to
@@ -89,11 +131,14 @@ struct Task<T>::ValuePromiseBase {
 
 template <typename T>
 struct Task<T>::Promise
-    : std::conditional_t<kIsVoidTask, VoidPromiseBase, ValuePromiseBase> {
+    : std::conditional_t<kIsVoidTask, VoidPromiseBase, ValuePromiseBase>,
+      frame_allocator::AllocatedFrame<Promise> {
   // Used to wake synchronous waiter.
   std::atomic_flag complete;
   // The coroutine waiting on this task's completion.
   std::coroutine_handle<> waiting;
+  // The executor to resume `waiting` on, if set by ResumeOnOrigin().
+  Executor* origin = nullptr;
   // Number of live references to our coroutine handle.
   std::atomic_size_t handle_reference_count;
   // The exception thrown by body of the task, if any.
@@ -101,6 +146,9 @@ struct Task<T>::Promise
 
   SharedHandle handle_ref;
 
+  [[no_unique_address]] trace::FrameTracer tracer{"Task"};
+  [[no_unique_address]] ArenaContext arena_context;
+
   Promise() {
     handle_reference_count.store(0, std::memory_order::relaxed);
     handle_ref =
@@ -128,17 +176,37 @@ struct Task<T>::Promise
   }
 
   // Lazy execution. Task body is deferred to the first explicit resume() call.
-  auto initial_suspend() noexcept { return std::suspend_always(); };
+  auto initial_suspend() noexcept {
+    return arena_context.Wrap(trace::Traced(std::suspend_always(), tracer));
+  };
+
+  // Pass-through, other than for tracing and switching arenas.
+  template <typename A>
+  decltype(auto) await_transform(A&& awaitable) {
+    // Without arenas, `awaitable` may be returned by reference, which must not
+    // be a reference to a temporary created here.
+    if constexpr (Arena::kEnabled) {
+      return arena_context.Wrap(
+          trace::Traced(std::forward<A>(awaitable), tracer));
+    } else {
+      return trace::Traced(std::forward<A>(awaitable), tracer);
+    }
+  }
 
   // Resume execution of parent coroutine that was awaiting this task's
   // completion, if any.
   auto final_suspend() noexcept {
+    tracer.Complete();
+    arena_context.Exit();
     struct FinalSuspend : std::suspend_always {
       Promise& promise;
 
       std::coroutine_handle<> await_suspend(
           [[maybe_unused]] std::coroutine_handle<> handle) {
         SharedHandle handle_ref = std::move(promise.handle_ref);
+        if (promise.origin != nullptr) {
+          return task_internal::TransferTo(*promise.origin, promise.waiting);
+        }
         if (promise.waiting) {
           return promise.waiting;
         }
@@ -169,6 +237,22 @@ auto Task<T>::operator co_await() && {
   return Awaiter{.task = std::move(*this)};
 }
 
+template <typename T>
+auto Task<T>::ResumeOnOrigin() && {
+  struct Awaiter : std::suspend_always {
+    Task task;
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> waiting) {
+      task.promise().waiting = waiting;
+      task.promise().origin = task_internal::CurrentExecutor();
+      return task.handle_.get();
+    }
+
+    auto await_resume() { return task.promise().ReturnOrThrow(); }
+  };
+  return Awaiter{.task = std::move(*this)};
+}
+
 template <typename T>
 T Task<T>::Wait() && {
   handle_->resume();
@@ -1,6 +1,7 @@
 #include <benchmark/benchmark.h>
 
-#include "task.h"
+#include "diy/coro/arena.h"
+#include "diy/coro/task.h"
 
 constexpr std::int64_t kBatchSize = 100'000;
 
@@ -24,5 +25,40 @@ static void BM_TrivialTask(benchmark::State& state) {
   state.SetItemsProcessed(kBatchSize * state.iterations());
 }
 
+// A request that runs a few dozen short-lived tasks.
+Task<int> Request() {
+  auto step = [](int i) -> Task<int> { co_return i; };
+  int sum = 0;
+  for (int i = 0; i < 32; ++i) {
+    sum += co_await step(i);
+  }
+  co_return sum;
+}
+
+static void BM_Request(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Request().Wait());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_RequestInArena(benchmark::State& state) {
+  if (!Arena::kEnabled) {
+    state.SkipWithError("Built without DIY_CORO_ARENAS");
+    return;
+  }
+  Arena arena;
+  for (auto _ : state) {
+    Task<int> task = [&] {
+      ArenaScope scope(arena);
+      return Request();
+    }();
+    benchmark::DoNotOptimize(std::move(task).Wait());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
 BENCHMARK(BM_TrivialFunction);
 BENCHMARK(BM_TrivialTask);
+BENCHMARK(BM_Request);
+BENCHMARK(BM_RequestInArena);
@@ -0,0 +1,229 @@
+#include "diy/coro/trace.h"
+
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace trace {
+namespace {
+
+std::int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Snapshot of a single event.
+struct EventRecord {
+  std::int64_t timestamp;
+  const void* frame;
+  const char* kind;
+  Event event;
+};
+
+// Single-producer single-consumer ring of events. The owning thread appends
+// without waiting; the flushing thread detects and discards any entries that
+// were overwritten while it was copying them.
+class ThreadBuffer {
+ public:
+  static constexpr std::uint64_t kCapacity = 1 << 14;
+
+  explicit ThreadBuffer(int tid) : tid(tid) {}
+
+  // Called only by the owning thread.
+  void Append(Event event, const void* frame, const char* kind) {
+    const std::uint64_t head = head_.load(std::memory_order::relaxed);
+    Entry& entry = entries_[head % kCapacity];
+    // Publishing the new head first marks the previous occupant of this entry
+    // as overwritten before we start modifying it. The release stores ensure
+    // that a reader observing any of the new fields also observes the new
+    // head.
+    head_.store(head + 1, std::memory_order::relaxed);
+    entry.timestamp.store(NowNanos(), std::memory_order::release);
+    entry.frame.store(frame, std::memory_order::release);
+    entry.kind.store(kind, std::memory_order::release);
+    entry.event.store(event, std::memory_order::release);
+    written_.store(head + 1, std::memory_order::release);
+  }
+
+  // Moves all complete entries not yet drained into `out`. Called only with
+  // the registry mutex held.
+  void Drain(std::vector<EventRecord>& out) {
+    const std::uint64_t end = written_.load(std::memory_order::acquire);
+    const std::uint64_t begin = std::max(drained_, end - std::min(end, kCapacity));
+    const std::size_t first = out.size();
+    for (std::uint64_t i = begin; i < end; ++i) {
+      const Entry& entry = entries_[i % kCapacity];
+      out.push_back(
+          {.timestamp = entry.timestamp.load(std::memory_order::acquire),
+           .frame = entry.frame.load(std::memory_order::acquire),
+           .kind = entry.kind.load(std::memory_order::acquire),
+           .event = entry.event.load(std::memory_order::acquire)});
+    }
+    // Entries that the writer has since lapped may be torn; drop them.
+    const std::uint64_t head = head_.load(std::memory_order::relaxed);
+    const std::uint64_t valid_begin =
+        std::max(begin, head - std::min(head, kCapacity));
+    out.erase(out.begin() + first,
+              out.begin() + first + static_cast<std::ptrdiff_t>(
+                                        std::min(valid_begin, end) - begin));
+    drained_ = end;
+  }
+
+  const int tid;
+  // Cleared when the owning thread exits.
+  std::atomic_bool alive = true;
+  // Slices that were resumed but not yet suspended as of the last flush,
+  // as (frame, timestamp) pairs. Only accessed with the registry mutex held.
+  std::vector<std::pair<const void*, std::int64_t>> open_slices;
+
+ private:
+  struct Entry {
+    std::atomic_int64_t timestamp;
+    std::atomic<const void*> frame;
+    std::atomic<const char*> kind;
+    std::atomic<Event> event;
+  };
+
+  // Number of entries claimed by the writer.
+  std::atomic_uint64_t head_ = 0;
+  // Number of entries fully written.
+  std::atomic_uint64_t written_ = 0;
+  // Number of entries consumed by Drain().
+  std::uint64_t drained_ = 0;
+  std::array<Entry, kCapacity> entries_;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  int next_tid = 1;
+};
+
+Registry& GetRegistry() {
+  // Leaked, so that threads exiting during static destruction can still
+  // unregister.
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+// Owns the calling thread's registration.
+class ThreadBufferHandle {
+ public:
+  ThreadBufferHandle() {
+    Registry& registry = GetRegistry();
+    auto lock = std::lock_guard(registry.mutex);
+    buffer_ = std::make_shared<ThreadBuffer>(registry.next_tid++);
+    registry.buffers.push_back(buffer_);
+  }
+
+  ~ThreadBufferHandle() {
+    buffer_->alive.store(false, std::memory_order::release);
+  }
+
+  ThreadBuffer& operator*() const { return *buffer_; }
+
+ private:
+  std::shared_ptr<ThreadBuffer> buffer_;
+};
+
+ThreadBuffer& CurrentThreadBuffer() {
+  thread_local ThreadBufferHandle handle;
+  return *handle;
+}
+
+void AppendCommonFields(std::string& out, const EventRecord& record, int tid) {
+  absl::StrAppendFormat(&out,
+                        R"("name":"%s","cat":"coro","pid":1,"tid":%d,)"
+                        R"("ts":%.3f)",
+                        record.kind, tid, record.timestamp / 1000.0);
+}
+
+}  // namespace
+
+void Record(Event event, const void* frame, const char* kind) {
+  CurrentThreadBuffer().Append(event, frame, kind);
+}
+
+std::string FlushChromeTrace() {
+  std::string out = R"({"displayTimeUnit":"ns","traceEvents":[)";
+  bool first = true;
+  auto begin_event = [&] {
+    if (!first) {
+      out += ",\n";
+    }
+    first = false;
+    out += "{";
+  };
+
+  Registry& registry = GetRegistry();
+  auto lock = std::lock_guard(registry.mutex);
+  std::vector<EventRecord> records;
+  for (const std::shared_ptr<ThreadBuffer>& buffer : registry.buffers) {
+    records.clear();
+    buffer->Drain(records);
+    for (const EventRecord& record : records) {
+      switch (record.event) {
+        case Event::kCreate:
+        case Event::kDestroy: {
+          begin_event();
+          AppendCommonFields(out, record, buffer->tid);
+          absl::StrAppendFormat(
+              &out, R"(,"ph":"%s","id":"%p"})",
+              record.event == Event::kCreate ? "b" : "e", record.frame);
+          break;
+        }
+        case Event::kResume: {
+          buffer->open_slices.emplace_back(record.frame, record.timestamp);
+          break;
+        }
+        case Event::kComplete: {
+          begin_event();
+          AppendCommonFields(out, record, buffer->tid);
+          absl::StrAppendFormat(
+              &out, R"(,"ph":"i","s":"t","args":{"frame":"%p"}})",
+              record.frame);
+          [[fallthrough]];
+        }
+        case Event::kSuspend: {
+          // Slices nest when a coroutine directly resumes another one, so the
+          // matching resumption is normally the innermost open slice.
+          auto& open = buffer->open_slices;
+          auto it = std::find_if(open.rbegin(), open.rend(), [&](auto& slice) {
+            return slice.first == record.frame;
+          });
+          if (it == open.rend()) {
+            // Resumed before tracing saw it, or the resumption was overwritten.
+            break;
+          }
+          const std::int64_t start = it->second;
+          open.erase(std::next(it).base());
+          EventRecord slice = record;
+          slice.timestamp = start;
+          begin_event();
+          AppendCommonFields(out, slice, buffer->tid);
+          absl::StrAppendFormat(
+              &out, R"(,"ph":"X","dur":%.3f,"args":{"frame":"%p"}})",
+              (record.timestamp - start) / 1000.0, record.frame);
+          break;
+        }
+      }
+    }
+  }
+  // Buffers of exited threads have nothing more to contribute.
+  std::erase_if(registry.buffers, [](const auto& buffer) {
+    return !buffer->alive.load(std::memory_order::acquire);
+  });
+  out += "]}\n";
+  return out;
+}
+
+}  // namespace trace
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "diy/coro/traits.h"
+
+// Coroutine lifecycle tracing. Enabled by building with DIY_CORO_TRACING
+// defined (see the DIY_ENABLE_TRACING CMake option); otherwise every hook
+// compiles away and promise types are unchanged in size.
+//
+// Each thread records into its own fixed-size ring buffer without locking; if
+// a buffer fills up before it is flushed, the oldest events are overwritten.
+namespace trace {
+
+#ifdef DIY_CORO_TRACING
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+
+enum class Event : std::uint8_t {
+  kCreate,
+  kResume,
+  kSuspend,
+  kComplete,
+  kDestroy,
+};
+
+// Appends an event to the calling thread's buffer. `frame` identifies the
+// coroutine, and `kind` (which must be a string literal) names its type.
+void Record(Event event, const void* frame, const char* kind);
+
+// Removes all events recorded so far, on all threads, and returns them in
+// Chrome's trace event JSON format; loadable in chrome://tracing or Perfetto.
+// Each resumption of a coroutine is shown as a slice on the thread it ran on,
+// and each coroutine's lifetime as an async span.
+std::string FlushChromeTrace();
+
+template <bool Enabled>
+class BasicFrameTracer;
+
+// Embedded in each promise type. Records the frame's creation and destruction
+// along with the promise, and provides hooks for the rest of its lifecycle.
+using FrameTracer = BasicFrameTracer<kEnabled>;
+
+template <>
+class BasicFrameTracer<false> {
+ public:
+  constexpr explicit BasicFrameTracer(const char*) {}
+
+  void Resume() const {}
+  void Suspend() const {}
+  void Complete() const {}
+};
+
+template <>
+class BasicFrameTracer<true> {
+ public:
+  explicit BasicFrameTracer(const char* kind) : kind_(kind) {
+    Record(Event::kCreate, this, kind_);
+  }
+  ~BasicFrameTracer() { Record(Event::kDestroy, this, kind_); }
+
+  BasicFrameTracer(const BasicFrameTracer&) = delete;
+  BasicFrameTracer& operator=(const BasicFrameTracer&) = delete;
+
+  void Resume() const { Record(Event::kResume, this, kind_); }
+  void Suspend() const { Record(Event::kSuspend, this, kind_); }
+  void Complete() const { Record(Event::kComplete, this, kind_); }
+
+ private:
+  const char* kind_;
+};
+
+// Wraps an awaiter so that suspending and resuming through it are recorded.
+// `A` may be a reference, to await on an lvalue awaiter in-place.
+template <typename A>
+struct TracedAwaiter {
+  A awaiter;
+  const FrameTracer& tracer;
+  bool suspended = false;
+
+  bool await_ready() { return awaiter.await_ready(); }
+
+  template <typename P>
+  auto await_suspend(std::coroutine_handle<P> handle) {
+    // Record before handing off, as the coroutine may be resumed (or
+    // destroyed) on another thread before the call returns.
+    suspended = true;
+    tracer.Suspend();
+    return awaiter.await_suspend(handle);
+  }
+
+  decltype(auto) await_resume() {
+    if (suspended) {
+      tracer.Resume();
+    }
+    return awaiter.await_resume();
+  }
+};
+
+// Returns `awaitable` unchanged if tracing is disabled. Otherwise returns an
+// awaiter that behaves the same, but records suspension and resumption of the
+// coroutine owning `tracer`.
+template <typename A>
+decltype(auto) Traced(A&& awaitable, const FrameTracer& tracer) {
+  if constexpr (!kEnabled) {
+    return std::forward<A>(awaitable);
+  } else if constexpr (traits::IsIndirectlyAwaitable<A>) {
+    using Awaiter = traits::AwaiterType<A>;
+    return TracedAwaiter<Awaiter>{
+        .awaiter = traits::ToAwaiter(std::forward<A>(awaitable)),
+        .tracer = tracer};
+  } else {
+    return TracedAwaiter<A>{.awaiter = std::forward<A>(awaitable),
+                            .tracer = tracer};
+  }
+}
+
+}  // namespace trace
@@ -0,0 +1,62 @@
+#include "diy/coro/trace.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <type_traits>
+
+#include "diy/coro/async_generator.h"
+#include "diy/coro/task.h"
+
+using testing::HasSubstr;
+using testing::Not;
+
+TEST(TraceTest, DisabledTracerIsEmpty) {
+  EXPECT_TRUE(std::is_empty_v<trace::BasicFrameTracer<false>>);
+}
+
+TEST(TraceTest, RecordsSlicesAndLifetimes) {
+  trace::FlushChromeTrace();
+  {
+    trace::BasicFrameTracer<true> tracer("TestFrame");
+    tracer.Resume();
+    tracer.Suspend();
+    tracer.Resume();
+    tracer.Complete();
+  }
+  const std::string json = trace::FlushChromeTrace();
+  EXPECT_THAT(json, HasSubstr(R"("name":"TestFrame")"));
+  EXPECT_THAT(json, HasSubstr(R"("ph":"b")"));
+  EXPECT_THAT(json, HasSubstr(R"("ph":"X")"));
+  EXPECT_THAT(json, HasSubstr(R"("ph":"i")"));
+  EXPECT_THAT(json, HasSubstr(R"("ph":"e")"));
+
+  // Flushing removes the events.
+  EXPECT_THAT(trace::FlushChromeTrace(), Not(HasSubstr("TestFrame")));
+}
+
+TEST(TraceTest, RecordsOtherThreads) {
+  trace::FlushChromeTrace();
+  std::jthread([] {
+    trace::BasicFrameTracer<true> tracer("OtherThread");
+    tracer.Resume();
+    tracer.Suspend();
+  }).join();
+  EXPECT_THAT(trace::FlushChromeTrace(), HasSubstr(R"("name":"OtherThread")"));
+}
+
+TEST(TraceTest, TracesCoroutines) {
+  if (!trace::kEnabled) {
+    GTEST_SKIP() << "Built without DIY_CORO_TRACING";
+  }
+  trace::FlushChromeTrace();
+  auto task = []() -> Task<int> {
+    auto gen = []() -> AsyncGenerator<int> { co_yield 1; }();
+    co_return *co_await gen;
+  };
+  EXPECT_EQ(task().Wait(), 1);
+  const std::string json = trace::FlushChromeTrace();
+  EXPECT_THAT(json, HasSubstr(R"("name":"Task","cat":"coro")"));
+  EXPECT_THAT(json, HasSubstr(R"("name":"AsyncGenerator","cat":"coro")"));
+}